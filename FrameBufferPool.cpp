@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#include "mdk/c/VideoFrame.h"
+#include "mdk/VideoFrame.h"
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace MDK_NS;
+
+extern PixelFormat fromC(MDK_PixelFormat fmt);
+extern mdkVideoFrameAPI* MDK_VideoFrame_toC(const VideoFrame& frame);
+
+static constexpr int kDefaultMaxFree = 4;
+static constexpr int kDefaultAlignment = 64;
+
+struct BlockKey {
+    MDK_PixelFormat format;
+    int width;
+    int height;
+    int alignment;
+
+    bool operator==(const BlockKey& k) const {
+        return format == k.format && width == k.width && height == k.height && alignment == k.alignment;
+    }
+};
+
+struct BlockKeyHash {
+    size_t operator()(const BlockKey& k) const {
+        size_t h = hash<int>()(k.format);
+        h = h * 31 + hash<int>()(k.width);
+        h = h * 31 + hash<int>()(k.height);
+        return h * 31 + hash<int>()(k.alignment);
+    }
+};
+
+class FrameBufferPool;
+
+/*
+  Header of a malloc block, followed by planes. Every plane buffer of a frame holds a ref, and the last deleter returns the block to pool.
+ */
+struct FrameBlock {
+    shared_ptr<FrameBufferPool> pool; // null if free
+    atomic<int> refs;
+    BlockKey key;
+    size_t size; // planes bytes
+};
+
+class FrameBufferPool : public enable_shared_from_this<FrameBufferPool> {
+public:
+    FrameBufferPool(int maxFree) : max_free_(maxFree > 0 ? maxFree : kDefaultMaxFree) {}
+
+    ~FrameBufferPool() { clear(); }
+
+    // block is not owned by any plane
+    FrameBlock* acquire(const BlockKey& key, size_t size) {
+        {
+            const lock_guard<mutex> lock(mtx_);
+            if (auto it = free_.find(key); it != free_.end() && !it->second.empty()) {
+                auto b = it->second.back();
+                it->second.pop_back();
+                free_bytes_ -= b->size;
+                --free_blocks_;
+                used_bytes_ += b->size;
+                ++used_blocks_;
+                ++hits_;
+                b->pool = shared_from_this();
+                return b;
+            }
+        }
+        auto m = malloc(sizeof(FrameBlock) + key.alignment + size);
+        if (!m)
+            return nullptr;
+        auto b = new(m) FrameBlock{shared_from_this(), {0}, key, size};
+        const lock_guard<mutex> lock(mtx_);
+        used_bytes_ += size;
+        ++used_blocks_;
+        ++misses_;
+        return b;
+    }
+
+    void recycle(FrameBlock* b) {
+        const lock_guard<mutex> lock(mtx_);
+        used_bytes_ -= b->size;
+        --used_blocks_;
+        auto& blocks = free_[b->key];
+        if ((int)blocks.size() >= max_free_) {
+            destroy(b);
+            return;
+        }
+        blocks.push_back(b);
+        free_bytes_ += b->size;
+        ++free_blocks_;
+    }
+
+    void clear() {
+        const lock_guard<mutex> lock(mtx_);
+        for (auto& i : free_) {
+            for (auto b : i.second)
+                destroy(b);
+        }
+        free_.clear();
+        free_bytes_ = 0;
+        free_blocks_ = 0;
+    }
+
+    // free blocks returned later
+    void close() {
+        {
+            const lock_guard<mutex> lock(mtx_);
+            max_free_ = 0;
+        }
+        clear();
+    }
+
+    void stats(mdkFrameBufferPoolStats* s) {
+        const lock_guard<mutex> lock(mtx_);
+        s->hits = hits_;
+        s->misses = misses_;
+        s->usedBlocks = used_blocks_;
+        s->freeBlocks = free_blocks_;
+        s->usedBytes = used_bytes_;
+        s->freeBytes = free_bytes_;
+    }
+
+    static uint8_t* data(FrameBlock* b) {
+        const auto p = (uintptr_t)(b + 1);
+        return (uint8_t*)((p + b->key.alignment - 1) & ~uintptr_t(b->key.alignment - 1));
+    }
+
+    static void destroy(FrameBlock* b) {
+        b->~FrameBlock();
+        free(b);
+    }
+private:
+    mutex mtx_;
+    int max_free_;
+    unordered_map<BlockKey, vector<FrameBlock*>, BlockKeyHash> free_;
+    int64_t hits_ = 0;
+    int64_t misses_ = 0;
+    int used_blocks_ = 0;
+    int free_blocks_ = 0;
+    int64_t used_bytes_ = 0;
+    int64_t free_bytes_ = 0;
+};
+
+struct mdkFrameBufferPool {
+    shared_ptr<FrameBufferPool> pool;
+};
+
+static void release_block(void** pBuf)
+{
+    auto b = (FrameBlock*)*pBuf;
+    *pBuf = nullptr;
+    if (!b || --b->refs > 0)
+        return;
+    const auto pool = std::move(b->pool); // pool can be released by the last block
+    pool->recycle(b);
+}
+
+extern "C" {
+
+mdkFrameBufferPool* mdkFrameBufferPool_new(int maxFreeBlocks)
+{
+    auto p = new mdkFrameBufferPool();
+    p->pool = make_shared<FrameBufferPool>(maxFreeBlocks);
+    return p;
+}
+
+void mdkFrameBufferPool_delete(mdkFrameBufferPool** pool)
+{
+    if (!pool || !*pool)
+        return;
+    (*pool)->pool->close();
+    delete *pool;
+    *pool = nullptr;
+}
+
+mdkVideoFrameAPI* mdkFrameBufferPool_newFrame(mdkFrameBufferPool* pool, int width, int height, MDK_PixelFormat format, int alignment)
+{
+    if (alignment <= 0)
+        alignment = kDefaultAlignment;
+    const VideoFormat fmt = fromC(format);
+    if (fmt == PixelFormat::Unknown || width <= 0 || height <= 0 || (alignment & (alignment - 1)))
+        return nullptr;
+    VideoFrame frame(width, height, fmt);
+    const int planes = fmt.planeCount();
+    int strides[4]{};
+    size_t offsets[4]{};
+    size_t size = 0;
+    for (int i = 0; i < planes && i < 4; ++i) {
+        strides[i] = (fmt.bytesPerLine(width, i) + alignment - 1) & ~(alignment - 1);
+        offsets[i] = size;
+        size += (size_t)strides[i] * frame.height(i);
+    }
+    const auto b = pool->pool->acquire({format, width, height, alignment}, size);
+    if (!b)
+        return nullptr;
+    b->refs = planes < 4 ? planes : 4;
+    const auto data = FrameBufferPool::data(b);
+    bool ok = true;
+    for (int i = 0; i < planes && i < 4; ++i) {
+        if (frame.addBuffer(data + offsets[i], strides[i], b, release_block, i))
+            continue;
+        void* buf = b;
+        release_block(&buf);
+        ok = false;
+    }
+    if (!ok) // added planes are released by frame
+        return nullptr;
+    return MDK_VideoFrame_toC(frame);
+}
+
+void mdkFrameBufferPool_clear(mdkFrameBufferPool* pool)
+{
+    pool->pool->clear();
+}
+
+void mdkFrameBufferPool_stats(mdkFrameBufferPool* pool, mdkFrameBufferPoolStats* stats)
+{
+    if (stats)
+        pool->pool->stats(stats);
+}
+
+} // extern "C"
@@ -6,15 +6,149 @@
 #include "mdk/VideoFormat.h"
 #include "MediaInfoInternal.h"
 #include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <cstring>
+#include <type_traits>
 
-static void from_abi(const AudioCodecParameters& in, mdkAudioCodecParameters& out)
+static constexpr uint32_t kMediaInfoArenaVersion = 1 | (uint32_t(sizeof(void*)) << 16);
+
+static inline size_t align8(size_t v)
 {
-    out.codec = in.codec.data();
-    out.codec_tag = in.codec_tag;
-    if (in.extra) {
-        out.extra_data = in.extra->constData();
-        out.extra_data_size = (int)in.extra->size();
+    return (v + 7) & ~size_t(7);
+}
+
+// offsets in arena
+struct ArenaLayout {
+    size_t chapters;
+    size_t audio;
+    size_t video;
+    size_t subtitle;
+    size_t programs;
+    size_t records;
+    size_t metadata;
+    size_t ints;
+    size_t bytes; // strings and bytes
+    size_t size;
+};
+
+static ArenaLayout arena_layout(size_t nb_chapters, size_t nb_audio, size_t nb_video, size_t nb_subtitle, size_t nb_programs, size_t nb_metadata, size_t nb_ints, size_t nb_bytes)
+{
+    ArenaLayout l{};
+    size_t n = sizeof(MediaInfoArena);
+    const auto place = [&n](size_t count, size_t elementSize) {
+        n = align8(n);
+        const auto offset = n;
+        n += count * elementSize;
+        return offset;
+    };
+    l.chapters = place(nb_chapters, sizeof(mdkChapterInfo));
+    l.audio = place(nb_audio, sizeof(mdkAudioStreamInfo));
+    l.video = place(nb_video, sizeof(mdkVideoStreamInfo));
+    l.subtitle = place(nb_subtitle, sizeof(mdkSubtitleStreamInfo));
+    l.programs = place(nb_programs, sizeof(mdkProgramInfo));
+    l.records = place(1 + nb_audio + nb_video + nb_subtitle + nb_programs, sizeof(MediaInfoRecord));
+    l.metadata = place(nb_metadata, sizeof(mdkStringMapEntry));
+    l.ints = place(nb_ints, sizeof(int));
+    l.bytes = n;
+    l.size = n + nb_bytes;
+    return l;
+}
+
+// set array pointers and priv from layout. records are in order media, audio, video, subtitle, program
+static void link_arena(MediaInfoArena* a, const ArenaLayout& l)
+{
+    const auto base = (char*)a;
+    auto& info = a->info;
+    auto r = (MediaInfoRecord*)(base + l.records);
+    info.priv = r++;
+    info.chapters = info.nb_chapters > 0 ? (mdkChapterInfo*)(base + l.chapters) : nullptr;
+    info.audio = info.nb_audio > 0 ? (mdkAudioStreamInfo*)(base + l.audio) : nullptr;
+    for (int i = 0; i < info.nb_audio; ++i)
+        info.audio[i].priv = r++;
+    info.video = info.nb_video > 0 ? (mdkVideoStreamInfo*)(base + l.video) : nullptr;
+    for (int i = 0; i < info.nb_video; ++i)
+        info.video[i].priv = r++;
+    info.subtitle = info.nb_subtitle > 0 ? (mdkSubtitleStreamInfo*)(base + l.subtitle) : nullptr;
+    for (int i = 0; i < info.nb_subtitle; ++i)
+        info.subtitle[i].priv = r++;
+    info.programs = info.nb_programs > 0 ? (mdkProgramInfo*)(base + l.programs) : nullptr;
+    for (int i = 0; i < info.nb_programs; ++i)
+        info.programs[i].priv = r++;
+    a->base = (uintptr_t)a;
+}
+
+static size_t bytes_of(const string& s)
+{
+    return s.size() + 1;
+}
+
+static size_t bytes_of(const char* s)
+{
+    return s ? strlen(s) + 1 : 0;
+}
+
+static size_t bytes_of(const BufferRef& b)
+{
+    return b ? b->size() : 0;
+}
+
+static size_t bytes_of(const unordered_map<string, string>& m)
+{
+    size_t n = 0;
+    for (const auto& i : m)
+        n += bytes_of(i.first) + bytes_of(i.second);
+    return n;
+}
+
+// copy strings and bytes to the end of arena
+class ArenaWriter {
+public:
+    ArenaWriter(char* begin, char* end) : p_(begin), end_(end) {}
+
+    const char* putString(const char* s, size_t len) {
+        assert(size_t(end_ - p_) > len && "arena overflow");
+        const auto d = p_;
+        memcpy(d, s, len);
+        d[len] = 0;
+        p_ += len + 1;
+        return d;
     }
+
+    const char* putString(const string& s) {
+        return putString(s.data(), s.size());
+    }
+
+    const char* putString(const char* s) {
+        if (!s)
+            return nullptr;
+        return putString(s, strlen(s));
+    }
+
+    const uint8_t* putBytes(const BufferRef& b, int* size) {
+        *size = 0;
+        if (!b || b->size() == 0)
+            return nullptr;
+        const auto len = b->size();
+        assert(size_t(end_ - p_) >= len && "arena overflow");
+        const auto d = (uint8_t*)p_;
+        memcpy(d, b->constData(), len);
+        p_ += len;
+        *size = (int)len;
+        return d;
+    }
+private:
+    char* p_;
+    char* end_;
+};
+
+static void from_abi(const AudioCodecParameters& in, mdkAudioCodecParameters& out, ArenaWriter& w)
+{
+    out.codec = w.putString(in.codec);
+    out.codec_tag = in.codec_tag;
+    out.extra_data = w.putBytes(in.extra, &out.extra_data_size);
     out.bit_rate = in.bit_rate;
     out.profile = in.profile;
     out.level = in.level;
@@ -36,24 +170,20 @@ static void from_abi(const AudioStreamInfo& in, mdkAudioStreamInfo& out)
     out.start_time = in.start_time;
     out.duration = in.duration;
     out.frames = in.frames;
-    out.priv = &in;
 }
 
-static void from_abi(const VideoCodecParameters& in, mdkVideoCodecParameters& out)
+static void from_abi(const VideoCodecParameters& in, mdkVideoCodecParameters& out, ArenaWriter& w)
 {
-    out.codec = in.codec.data();
+    out.codec = w.putString(in.codec);
     out.codec_tag = in.codec_tag;
-    if (in.extra) {
-        out.extra_data = in.extra->constData();
-        out.extra_data_size = (int)in.extra->size();
-    }
+    out.extra_data = w.putBytes(in.extra, &out.extra_data_size);
     out.bit_rate = in.bit_rate;
     out.profile = in.profile;
     out.level = in.level;
     out.frame_rate = in.frame_rate;
 
     out.format = (int)in.format;
-    out.format_name = VideoFormat(in.format).name();
+    out.format_name = w.putString(VideoFormat(in.format).name());
     out.width = in.width;
     out.height = in.height;
     out.b_frames = in.b_frames;
@@ -67,17 +197,13 @@ static void from_abi(const VideoStreamInfo& in, mdkVideoStreamInfo& out)
     out.duration = in.duration;
     out.frames = in.frames;
     out.rotation = in.rotation;
-    out.priv = &in;
 }
 
-static void from_abi(const SubtitleCodecParameters& in, mdkSubtitleCodecParameters& out)
+static void from_abi(const SubtitleCodecParameters& in, mdkSubtitleCodecParameters& out, ArenaWriter& w)
 {
-    out.codec = in.codec.data();
+    out.codec = w.putString(in.codec);
     out.codec_tag = in.codec_tag;
-    if (in.extra) {
-        out.extra_data = in.extra->constData();
-        out.extra_data_size = (int)in.extra->size();
-    }
+    out.extra_data = w.putBytes(in.extra, &out.extra_data_size);
     out.width = in.width;
     out.height = in.height;
 }
@@ -87,174 +213,443 @@ static void from_abi(const SubtitleStreamInfo& in, mdkSubtitleStreamInfo& out)
     out.index = in.index;
     out.start_time = in.start_time;
     out.duration = in.duration;
-    out.priv = &in;
 }
 
-static void from_abi(const ChapterInfo& in, mdkChapterInfo& out)
+static void from_abi(const ChapterInfo& in, mdkChapterInfo& out, ArenaWriter& w)
 {
     out.start_time = in.start_time;
     out.end_time = in.end_time;
     if (in.title.empty())
         out.title = nullptr;
     else
-        out.title = in.title.data();
-    out.priv = &in;
+        out.title = w.putString(in.title);
 }
 
-static void from_abi(const ProgramInfo& in, mdkProgramInfo& out)
+static void from_abi(const ProgramInfo& in, mdkProgramInfo& out, int*& ints)
 {
     out.id = in.id;
-    out.stream = in.stream.data();
     out.nb_stream = (int)in.stream.size();
-    out.priv = &in;
+    out.stream = nullptr;
+    if (!in.stream.empty()) {
+        memcpy(ints, in.stream.data(), in.stream.size() * sizeof(int));
+        out.stream = ints;
+        ints += in.stream.size();
+    }
 }
 
-static void from_abi(const MediaInfo& in, mdkMediaInfo& out)
+static void from_abi(const MediaInfo& in, mdkMediaInfo& out, ArenaWriter& w)
 {
     out.start_time = in.start_time;
     out.duration = in.duration;
     out.bit_rate = in.bit_rate;
-    out.format = in.format.data();
+    out.format = w.putString(in.format);
     out.streams = (int)in.streams;
     out.nb_chapters = (int)in.chapters.size();
     out.nb_audio = (int)in.audio.size();
     out.nb_video = (int)in.video.size();
     out.nb_subtitle = (int)in.subtitle.size();
     out.nb_programs = (int)in.program.size();
+}
+
+static void from_abi(const unordered_map<string, string>& in, MediaInfoRecord& r, ArenaWriter& w, mdkStringMapEntry*& m)
+{
+    r.metadata = m;
+    r.nb_metadata = (int)in.size();
+    for (const auto& i : in) {
+        m->key = w.putString(i.first);
+        m->value = w.putString(i.second);
+        m->priv = nullptr;
+        ++m;
+    }
+}
 
-    out.priv = &in;
+const mdkMediaInfo* MediaInfoInternal::info() const
+{
+    static const mdkMediaInfo empty{};
+    return arena ? &arena->info : &empty;
 }
 
-void MediaInfoToC(const MediaInfo& abi, MediaInfoInternal* out)
+void MediaInfoToC(const MediaInfo& in, MediaInfoInternal* out)
 {
     if (!out)
         return;
-    *out = MediaInfoInternal{};
-    out->abi = abi;
+    size_t nb_metadata = in.metadata.size();
+    size_t nb_ints = 0;
+    size_t nb_bytes = bytes_of(in.format) + bytes_of(in.metadata);
+    for (const auto& i : in.chapters) {
+        if (!i.title.empty())
+            nb_bytes += bytes_of(i.title);
+    }
+    for (const auto& i : in.audio) {
+        nb_metadata += i.metadata.size();
+        nb_bytes += bytes_of(i.metadata) + bytes_of(i.codec.codec) + bytes_of(i.codec.extra);
+    }
+    for (const auto& i : in.video) {
+        nb_metadata += i.metadata.size();
+        nb_bytes += bytes_of(i.metadata) + bytes_of(i.codec.codec) + bytes_of(i.codec.extra) + bytes_of(VideoFormat(i.codec.format).name()) + bytes_of(i.image);
+    }
+    for (const auto& i : in.subtitle) {
+        nb_metadata += i.metadata.size();
+        nb_bytes += bytes_of(i.metadata) + bytes_of(i.codec.codec) + bytes_of(i.codec.extra);
+    }
+    for (const auto& i : in.program) {
+        nb_metadata += i.metadata.size();
+        nb_ints += i.stream.size();
+        nb_bytes += bytes_of(i.metadata);
+    }
+    const auto l = arena_layout(in.chapters.size(), in.audio.size(), in.video.size(), in.subtitle.size(), in.program.size(), nb_metadata, nb_ints, nb_bytes);
+    auto a = (MediaInfoArena*)calloc(1, l.size);
+    out->arena.reset(a);
+    if (!a)
+        return;
+    a->version = kMediaInfoArenaVersion;
+    a->refs = 1;
+    a->nb_metadata = (uint32_t)nb_metadata;
+    a->nb_ints = (uint32_t)nb_ints;
+    a->size = l.size;
 
-    for (const auto& i : out->abi.chapters) {
-        mdkChapterInfo ci;
-        from_abi(i, ci);
-        out->c.push_back(ci);
+    const auto base = (char*)a;
+    ArenaWriter w(base + l.bytes, base + l.size);
+    auto r = (MediaInfoRecord*)(base + l.records);
+    auto m = (mdkStringMapEntry*)(base + l.metadata);
+    auto ints = (int*)(base + l.ints);
+    auto& info = a->info;
+    from_abi(in, info, w);
+    link_arena(a, l);
+    from_abi(in.metadata, *r++, w, m);
+
+    for (size_t i = 0; i < in.chapters.size(); ++i)
+        from_abi(in.chapters[i], info.chapters[i], w);
+
+    for (size_t i = 0; i < in.audio.size(); ++i, ++r) {
+        from_abi(in.audio[i], info.audio[i]);
+        from_abi(in.audio[i].codec, r->codec.audio, w);
+        from_abi(in.audio[i].metadata, *r, w, m);
+    }
+
+    for (size_t i = 0; i < in.video.size(); ++i, ++r) {
+        from_abi(in.video[i], info.video[i]);
+        from_abi(in.video[i].codec, r->codec.video, w);
+        from_abi(in.video[i].metadata, *r, w, m);
+        r->image = w.putBytes(in.video[i].image, &r->image_size);
     }
-    out->info.chapters = nullptr;
-    if (!out->c.empty())
-        out->info.chapters = &out->c[0];
-
-    for (const auto& i : out->abi.program) {
-        mdkProgramInfo pi;
-        from_abi(i, pi);
-        out->p.push_back(pi);
+
+    for (size_t i = 0; i < in.subtitle.size(); ++i, ++r) {
+        from_abi(in.subtitle[i], info.subtitle[i]);
+        from_abi(in.subtitle[i].codec, r->codec.subtitle, w);
+        from_abi(in.subtitle[i].metadata, *r, w, m);
+    }
+
+    for (size_t i = 0; i < in.program.size(); ++i, ++r) {
+        from_abi(in.program[i], info.programs[i], ints);
+        from_abi(in.program[i].metadata, *r, w, m);
     }
-    out->info.programs = nullptr;
-    if (!out->p.empty())
-        out->info.programs = &out->p[0];
-
-    for (const auto& i : out->abi.audio) {
-        mdkAudioStreamInfo si;
-        from_abi(i, si);
-        out->a.push_back(si);
+}
+
+template<class StreamInfo, class CStreamInfo>
+static void update_streams(const vector<StreamInfo>& in, CStreamInfo* out, int count)
+{
+    if (in.size() != size_t(count))
+        return;
+    for (int i = 0; i < count; ++i) {
+        out[i].start_time = in[i].start_time;
+        out[i].duration = in[i].duration;
     }
-    if (!out->a.empty())
-        out->info.audio = &out->a[0];
+}
+
+static void update_info(const MediaInfo& abi, mdkMediaInfo& info)
+{
+    info.start_time = abi.start_time;
+    info.duration = abi.duration;
+    info.bit_rate = abi.bit_rate;
+    update_streams(abi.audio, info.audio, info.nb_audio);
+    update_streams(abi.video, info.video, info.nb_video);
+    update_streams(abi.subtitle, info.subtitle, info.nb_subtitle);
+}
+
+void MediaInfoUpdateC(const MediaInfo& abi, MediaInfoInternal* out)
+{
+    if (!out || !out->arena)
+        return;
+    update_info(abi, out->arena->info);
+}
+
+MediaInfoArena* MediaInfoRetain(MediaInfoArena* a)
+{
+    if (a)
+        a->refs.fetch_add(1, memory_order_relaxed);
+    return a;
+}
+
+void MediaInfoRelease(MediaInfoArena* a)
+{
+    if (a && a->refs.fetch_sub(1, memory_order_acq_rel) == 1)
+        free(a);
+}
+
+bool MediaInfoRebase(MediaInfoArena* a, size_t size)
+{
+    if (!a || size < sizeof(*a) || a->version != kMediaInfoArenaVersion || a->size != size)
+        return false;
+    auto& info = a->info;
+    if (info.nb_chapters < 0 || info.nb_audio < 0 || info.nb_video < 0 || info.nb_subtitle < 0 || info.nb_programs < 0)
+        return false;
+    // an element takes at least 1 byte, so layout does not overflow
+    if ((uint64_t)info.nb_chapters + info.nb_audio + info.nb_video + info.nb_subtitle + info.nb_programs + a->nb_metadata + a->nb_ints > size)
+        return false;
+    const auto l = arena_layout(info.nb_chapters, info.nb_audio, info.nb_video, info.nb_subtitle, info.nb_programs, a->nb_metadata, a->nb_ints, 0);
+    if (l.size > size)
+        return false;
+    const auto old = (uintptr_t)a->base;
+    link_arena(a, l);
+    const auto base = (char*)a;
+    // offset of a pointer in old arena, size if out of range
+    const auto offset_of = [=](const void* p) {
+        const auto off = (uintptr_t)p - old;
+        return off < size ? (size_t)off : size;
+    };
+    const auto fix_string = [&](const char*& s) {
+        if (!s)
+            return true;
+        const auto off = offset_of(s);
+        if (off < l.bytes || off >= size || !memchr(base + off, 0, size - off))
+            return false;
+        s = base + off;
+        return true;
+    };
+    const auto fix_bytes = [&](const uint8_t*& d, int len) {
+        if (!d)
+            return len == 0;
+        const auto off = offset_of(d);
+        if (off < l.bytes || off >= size || len < 0 || size_t(len) > size - off)
+            return false;
+        d = (const uint8_t*)base + off;
+        return true;
+    };
+    const auto fix_metadata = [&](MediaInfoRecord& r) {
+        if (r.nb_metadata == 0) {
+            r.metadata = nullptr;
+            return true;
+        }
+        const auto off = offset_of(r.metadata);
+        const auto end = l.metadata + a->nb_metadata * sizeof(mdkStringMapEntry);
+        if (r.nb_metadata < 0 || off < l.metadata || (off - l.metadata) % sizeof(mdkStringMapEntry) || size_t(r.nb_metadata) > (end - off) / sizeof(mdkStringMapEntry))
+            return false;
+        r.metadata = (const mdkStringMapEntry*)(base + off);
+        return true;
+    };
 
-    for (const auto& i : out->abi.video) {
-        mdkVideoStreamInfo si;
-        from_abi(i, si);
-        out->v.push_back(si);
+    bool ok = fix_string(info.format);
+    for (int i = 0; ok && i < info.nb_chapters; ++i) {
+        info.chapters[i].priv = nullptr;
+        ok = fix_string(info.chapters[i].title);
     }
-    if (!out->v.empty())
-        out->info.video = &out->v[0];
+    auto r = (MediaInfoRecord*)(base + l.records);
+    ok = ok && fix_metadata(*r++);
+    for (int i = 0; ok && i < info.nb_audio; ++i, ++r) {
+        auto& c = r->codec.audio;
+        ok = fix_string(c.codec) && fix_bytes(c.extra_data, c.extra_data_size) && fix_metadata(*r);
+    }
+    for (int i = 0; ok && i < info.nb_video; ++i, ++r) {
+        auto& c = r->codec.video;
+        ok = fix_string(c.codec) && fix_bytes(c.extra_data, c.extra_data_size) && fix_string(c.format_name)
+            && fix_metadata(*r) && fix_bytes(r->image, r->image_size);
+    }
+    for (int i = 0; ok && i < info.nb_subtitle; ++i, ++r) {
+        auto& c = r->codec.subtitle;
+        ok = fix_string(c.codec) && fix_bytes(c.extra_data, c.extra_data_size) && fix_metadata(*r);
+    }
+    for (int i = 0; ok && i < info.nb_programs; ++i, ++r) {
+        auto& p = info.programs[i];
+        ok = fix_metadata(*r);
+        if (!ok || !p.stream) {
+            ok = ok && p.nb_stream == 0;
+            continue;
+        }
+        const auto off = offset_of(p.stream);
+        const auto end = l.ints + a->nb_ints * sizeof(int);
+        ok = p.nb_stream >= 0 && off >= l.ints && (off - l.ints) % sizeof(int) == 0 && size_t(p.nb_stream) <= (end - off) / sizeof(int);
+        p.stream = (const int*)(base + off);
+    }
+    auto m = (mdkStringMapEntry*)(base + l.metadata);
+    for (uint32_t i = 0; ok && i < a->nb_metadata; ++i) {
+        m[i].priv = nullptr;
+        ok = m[i].key && m[i].value && fix_string(m[i].key) && fix_string(m[i].value);
+    }
+    return ok;
+}
+
+void MediaInfoSerialize(const MediaInfoInternal& in, vector<char>& out)
+{
+    out.clear();
+    if (const auto a = in.arena.get())
+        out.assign((const char*)a, (const char*)a + a->size); // refs is reset by MediaInfoDeserialize()
+}
 
-    for (const auto& i : out->abi.subtitle) {
-        mdkSubtitleStreamInfo si;
-        from_abi(i, si);
-        out->s.push_back(si);
+// copy except refs, which can be changed by other threads
+static MediaInfoArena* arena_copy(const void* data, size_t size)
+{
+    if (!data || size < sizeof(MediaInfoArena))
+        return nullptr;
+    auto a = (MediaInfoArena*)malloc(size);
+    if (!a)
+        return nullptr;
+    constexpr auto refs_begin = offsetof(MediaInfoArena, refs);
+    constexpr auto refs_end = refs_begin + sizeof(MediaInfoArena::refs);
+    memcpy(static_cast<void*>(a), data, refs_begin);
+    memcpy((char*)a + refs_end, (const char*)data + refs_end, size - refs_end);
+    if (!MediaInfoRebase(a, size)) {
+        free(a);
+        return nullptr;
     }
-    if (!out->s.empty())
-        out->info.subtitle = &out->s[0];
+    new (&a->refs) atomic<int>(1);
+    return a;
+}
+
+bool MediaInfoDeserialize(const void* data, size_t size, MediaInfoInternal* out)
+{
+    if (!out)
+        return false;
+    out->arena.reset(arena_copy(data, size));
+    return !!out->arena;
+}
 
-    from_abi(out->abi, out->info);
+static inline const MediaInfoRecord* record_of(const void* priv)
+{
+    return static_cast<const MediaInfoRecord*>(priv);
 }
 
-template<class InfoAbi, class Info>
+template<class Info>
 bool MDK_GetMetaData(const Info* info, mdkStringMapEntry* entry)
 {
     if (!info)
         return false;
     assert(entry && "entry can not be null");
-    auto abi = reinterpret_cast<const InfoAbi*>(info->priv);
-    auto it = abi->metadata.cend();
-    if (entry->priv) {
-        auto pit = (decltype(it)*)entry->priv;
-        it = *pit;
-        it++;
-        delete pit;
+    const auto r = record_of(info->priv);
+    int i = r->nb_metadata;
+    if (entry->priv) { // index of the next entry
+        i = (int)(intptr_t)entry->priv;
     } else if (entry->key) {
-        it = abi->metadata.find(entry->key);
+        for (i = 0; i < r->nb_metadata; ++i) {
+            if (strcmp(r->metadata[i].key, entry->key) == 0)
+                break;
+        }
     } else {
-        it = abi->metadata.cbegin();
+        i = 0;
     }
-    if (it == abi->metadata.cend())
+    if (i >= r->nb_metadata) {
+        entry->priv = nullptr;
         return false;
-    entry->key = it->first.data();
-    entry->value = it->second.data();
-    entry->priv = new decltype(it)(it);
+    }
+    entry->key = r->metadata[i].key;
+    entry->value = r->metadata[i].value;
+    entry->priv = (void*)(intptr_t)(i + 1);
     return true;
 }
 
+template<class Info>
+int MDK_GetMetaDataEntries(const Info* info, mdkStringMapEntry* entries, int count)
+{
+    if (!info)
+        return 0;
+    const auto r = record_of(info->priv);
+    if (entries) {
+        for (int i = 0; i < r->nb_metadata && i < count; ++i)
+            entries[i] = r->metadata[i];
+    }
+    return r->nb_metadata;
+}
+
 extern "C" {
 
 void MDK_AudioStreamCodecParameters(const mdkAudioStreamInfo* info, mdkAudioCodecParameters* p)
 {
-    auto abi = reinterpret_cast<const AudioStreamInfo*>(info->priv);
-    from_abi(abi->codec, *p);
+    *p = record_of(info->priv)->codec.audio;
 }
 
 void MDK_VideoStreamCodecParameters(const mdkVideoStreamInfo* info, mdkVideoCodecParameters* p)
 {
-    auto abi = reinterpret_cast<const VideoStreamInfo*>(info->priv);
-    from_abi(abi->codec, *p);
+    *p = record_of(info->priv)->codec.video;
 }
 
 void MDK_SubtitleStreamCodecParameters(const mdkSubtitleStreamInfo* info, mdkSubtitleCodecParameters* p)
 {
-    auto abi = reinterpret_cast<const SubtitleStreamInfo*>(info->priv);
-    from_abi(abi->codec, *p);
+    *p = record_of(info->priv)->codec.subtitle;
 }
 
 bool MDK_AudioStreamMetadata(const mdkAudioStreamInfo* info, mdkStringMapEntry* entry)
 {
-    return MDK_GetMetaData<AudioStreamInfo>(info, entry);
+    return MDK_GetMetaData(info, entry);
 }
 
 bool MDK_VideoStreamMetadata(const mdkVideoStreamInfo* info, mdkStringMapEntry* entry)
 {
-    return MDK_GetMetaData<VideoStreamInfo>(info, entry);
+    return MDK_GetMetaData(info, entry);
 }
 
 bool MDK_MediaMetadata(const mdkMediaInfo* info, mdkStringMapEntry* entry)
 {
-    return MDK_GetMetaData<MediaInfo>(info, entry);
+    return MDK_GetMetaData(info, entry);
 }
 
 bool MDK_SubtitleStreamMetadata(const mdkSubtitleStreamInfo* info, mdkStringMapEntry* entry)
 {
-    return MDK_GetMetaData<SubtitleStreamInfo>(info, entry);
+    return MDK_GetMetaData(info, entry);
 }
 
 bool MDK_ProgramMetadata(const mdkProgramInfo* info, mdkStringMapEntry* entry)
 {
-    return MDK_GetMetaData<ProgramInfo>(info, entry);
+    return MDK_GetMetaData(info, entry);
+}
+
+int MDK_AudioStreamMetadataEntries(const mdkAudioStreamInfo* info, mdkStringMapEntry* entries, int count)
+{
+    return MDK_GetMetaDataEntries(info, entries, count);
+}
+
+int MDK_VideoStreamMetadataEntries(const mdkVideoStreamInfo* info, mdkStringMapEntry* entries, int count)
+{
+    return MDK_GetMetaDataEntries(info, entries, count);
+}
+
+int MDK_MediaMetadataEntries(const mdkMediaInfo* info, mdkStringMapEntry* entries, int count)
+{
+    return MDK_GetMetaDataEntries(info, entries, count);
+}
+
+int MDK_SubtitleStreamMetadataEntries(const mdkSubtitleStreamInfo* info, mdkStringMapEntry* entries, int count)
+{
+    return MDK_GetMetaDataEntries(info, entries, count);
+}
+
+int MDK_ProgramMetadataEntries(const mdkProgramInfo* info, mdkStringMapEntry* entries, int count)
+{
+    return MDK_GetMetaDataEntries(info, entries, count);
+}
+
+const mdkMediaInfo* MDK_MediaInfo_retain(const mdkMediaInfo* info)
+{
+    if (!info)
+        return nullptr;
+    MediaInfoRetain((MediaInfoArena*)((const char*)info - offsetof(MediaInfoArena, info)));
+    return info;
+}
+
+void MDK_MediaInfo_release(const mdkMediaInfo** info)
+{
+    if (!info || !*info)
+        return;
+    MediaInfoRelease((MediaInfoArena*)((const char*)*info - offsetof(MediaInfoArena, info)));
+    *info = nullptr;
 }
 
 const uint8_t* MDK_VideoStreamData(const mdkVideoStreamInfo* info, int* len, int flags)
 {
     if (flags == 0) {
-        if (auto i = reinterpret_cast<const VideoStreamInfo*>(info->priv)->image) {
+        if (const auto r = record_of(info->priv); r->image) {
             if (len)
-                *len = (int)i->size();
-            return i->data();
+                *len = r->image_size;
+            return r->image;
         }
     }
     return nullptr;
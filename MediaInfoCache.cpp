@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#include "MediaInfoCache.h"
+#include <cstdio>
+#include <cstring>
+#if (_WIN32 + 0)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+  Cache file layout, native endian:
+  CacheHeader, then count entries in LRU order(most recently used first). An entry is CacheEntryHeader, path, value, path and value are 8 bytes aligned.
+ */
+static constexpr char kCacheMagic[8] = {'M', 'D', 'K', 'I', 'N', 'F', 'O', 0};
+static constexpr uint32_t kCacheVersion = 2;
+static constexpr int64_t kDefaultMaxBytes = 64 << 20;
+static constexpr int kFlushPuts = 16;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+};
+
+struct CacheEntryHeader {
+    uint32_t path_size;
+    uint32_t data_size;
+    int64_t size;
+    int64_t mtime;
+};
+
+static inline size_t align8(size_t v)
+{
+    return (v + 7) & ~size_t(7);
+}
+
+#if (_WIN32 + 0)
+static wstring to_wide(const char* s)
+{
+    const int n = MultiByteToWideChar(CP_UTF8, 0, s, -1, nullptr, 0);
+    if (n <= 0)
+        return {};
+    wstring w(n - 1, 0);
+    MultiByteToWideChar(CP_UTF8, 0, s, -1, &w[0], n);
+    return w;
+}
+#endif
+
+static FILE* open_file(const char* path, const char* mode)
+{
+#if (_WIN32 + 0)
+    return _wfopen(to_wide(path).data(), to_wide(mode).data());
+#else
+    return fopen(path, mode);
+#endif
+}
+
+static bool rename_file(const char* from, const char* to)
+{
+#if (_WIN32 + 0)
+    return MoveFileExW(to_wide(from).data(), to_wide(to).data(), MOVEFILE_REPLACE_EXISTING);
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+// path, size and modification time of a local file url. false if not a local file
+static bool local_file(const char* url, string& path, int64_t& size, int64_t& mtime)
+{
+    if (!url || !*url)
+        return false;
+    if (strncmp(url, "file:", 5) == 0) {
+        url += 5;
+        if (strncmp(url, "//", 2) == 0)
+            url += 2;
+#if (_WIN32 + 0)
+        if (url[0] == '/' && url[1] && url[2] == ':') // file:///C:/
+            ++url;
+#endif
+    } else if (strstr(url, "://")) {
+        return false;
+    }
+    path = url;
+#if (_WIN32 + 0)
+    WIN32_FILE_ATTRIBUTE_DATA a;
+    if (!GetFileAttributesExW(to_wide(url).data(), GetFileExInfoStandard, &a) || (a.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        return false;
+    size = ((int64_t)a.nFileSizeHigh << 32) | a.nFileSizeLow;
+    mtime = ((int64_t)a.ftLastWriteTime.dwHighDateTime << 32) | a.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat st;
+    if (stat(url, &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+    size = st.st_size;
+# if defined(__APPLE__)
+    mtime = st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+# elif defined(__linux__)
+    mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+# else
+    mtime = st.st_mtime * 1000000000LL;
+# endif
+#endif
+    return true;
+}
+
+bool MappedFile::open(const char* path)
+{
+    close();
+#if (_WIN32 + 0)
+    auto f = CreateFileW(to_wide(path).data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(f, &size) || size.QuadPart <= 0) {
+        CloseHandle(f);
+        return false;
+    }
+    auto m = CreateFileMappingW(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) {
+        CloseHandle(f);
+        return false;
+    }
+    auto data = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+    file_ = f;
+    map_ = m;
+    data_ = (const char*)data;
+    size_ = (size_t)size.QuadPart;
+#else
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    auto data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // mapping is still valid
+    if (data == MAP_FAILED)
+        return false;
+    data_ = (const char*)data;
+    size_ = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (!data_)
+        return;
+#if (_WIN32 + 0)
+    UnmapViewOfFile(data_);
+    CloseHandle(map_);
+    CloseHandle(file_);
+    map_ = nullptr;
+    file_ = nullptr;
+#else
+    munmap((void*)data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+MediaInfoCache::MediaInfoCache(const char* path, int64_t maxBytes)
+    : path_(path)
+    , max_bytes_(size_t(maxBytes > 0 ? maxBytes : kDefaultMaxBytes))
+{
+    load();
+}
+
+MediaInfoCache::~MediaInfoCache()
+{
+    flush();
+}
+
+bool MediaInfoCache::get(const char* url, MediaInfoInternal* out)
+{
+    string path;
+    int64_t size = 0;
+    int64_t mtime = 0;
+    if (!local_file(url, path, size, mtime))
+        return false;
+    const lock_guard<mutex> lock(mtx_);
+    const auto it = index_.find(path);
+    if (it == index_.end())
+        return false;
+    const auto e = it->second;
+    if (e->size != size || e->mtime != mtime) // changed, will be replaced by put()
+        return false;
+    if (!MediaInfoDeserialize(e->data, e->data_size, out)) {
+        bytes_ -= bytesOf(*e);
+        lru_.erase(e);
+        index_.erase(it);
+        dirty_ = true;
+        return false;
+    }
+    if (e != lru_.begin()) {
+        lru_.splice(lru_.begin(), lru_, e);
+        dirty_ = true;
+    }
+    return true;
+}
+
+void MediaInfoCache::put(const char* url, const MediaInfoInternal& info)
+{
+    Entry e;
+    if (!local_file(url, e.path, e.size, e.mtime))
+        return;
+    MediaInfoSerialize(info, e.owned);
+    e.data = e.owned.data(); // not changed after move
+    e.data_size = e.owned.size();
+    const lock_guard<mutex> lock(mtx_);
+    insert(std::move(e));
+    dirty_ = true;
+    if (++puts_ >= kFlushPuts) // not only in dtor, a crash or kill loses at most kFlushPuts entries
+        flushLocked();
+}
+
+bool MediaInfoCache::flush()
+{
+    const lock_guard<mutex> lock(mtx_);
+    return flushLocked();
+}
+
+bool MediaInfoCache::flushLocked()
+{
+    if (!dirty_)
+        return true;
+    puts_ = 0;
+    const auto tmp = path_ + ".tmp";
+    auto f = open_file(tmp.data(), "wb");
+    if (!f)
+        return false;
+    static const char zeros[8]{};
+    CacheHeader h{};
+    memcpy(h.magic, kCacheMagic, sizeof(h.magic));
+    h.version = kCacheVersion;
+    h.count = (uint32_t)lru_.size();
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (auto it = lru_.cbegin(); ok && it != lru_.cend(); ++it) {
+        const CacheEntryHeader eh{(uint32_t)it->path.size(), (uint32_t)it->data_size, it->size, it->mtime};
+        ok = fwrite(&eh, sizeof(eh), 1, f) == 1
+            && fwrite(it->path.data(), 1, it->path.size(), f) == it->path.size()
+            && fwrite(zeros, 1, align8(it->path.size()) - it->path.size(), f) == align8(it->path.size()) - it->path.size()
+            && fwrite(it->data, 1, it->data_size, f) == it->data_size
+            && fwrite(zeros, 1, align8(it->data_size) - it->data_size, f) == align8(it->data_size) - it->data_size;
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        remove(tmp.data());
+        return false;
+    }
+    // the mapping must be closed before replacing the file. entries pointing to the mapping are copied out, and kept if rename failed
+    for (auto& e : lru_) {
+        if (!e.owned.empty())
+            continue;
+        e.owned.assign(e.data, e.data + e.data_size);
+        e.data = e.owned.data();
+    }
+    file_.close();
+    if (!rename_file(tmp.data(), path_.data())) {
+        remove(tmp.data());
+        return false; // still dirty
+    }
+    // read from the new mapping, release owned data
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+    load();
+    return true;
+}
+
+void MediaInfoCache::load()
+{
+    dirty_ = false;
+    if (!file_.open(path_.data()))
+        return;
+    const auto begin = file_.data();
+    const auto end = begin + file_.size();
+    CacheHeader h;
+    if (file_.size() < sizeof(h)) {
+        file_.close();
+        return;
+    }
+    memcpy(&h, begin, sizeof(h));
+    if (memcmp(h.magic, kCacheMagic, sizeof(h.magic)) != 0 || h.version != kCacheVersion) {
+        file_.close();
+        return;
+    }
+    auto p = begin + sizeof(h);
+    for (uint32_t i = 0; i < h.count; ++i) {
+        CacheEntryHeader eh;
+        if (size_t(end - p) < sizeof(eh))
+            break;
+        memcpy(&eh, p, sizeof(eh));
+        p += sizeof(eh);
+        if (size_t(end - p) < align8(eh.path_size) + eh.data_size)
+            break;
+        Entry e;
+        e.path.assign(p, eh.path_size);
+        p += align8(eh.path_size);
+        e.size = eh.size;
+        e.mtime = eh.mtime;
+        e.data = p;
+        e.data_size = eh.data_size;
+        p += align8(eh.data_size) < size_t(end - p) ? align8(eh.data_size) : size_t(end - p);
+        const auto bytes = bytesOf(e);
+        if (index_.count(e.path) || bytes_ + bytes > max_bytes_) // max bytes can be smaller than the last time
+            continue;
+        lru_.push_back(std::move(e));
+        index_[lru_.back().path] = std::prev(lru_.end());
+        bytes_ += bytes;
+    }
+}
+
+void MediaInfoCache::insert(Entry&& e)
+{
+    const auto bytes = bytesOf(e);
+    if (bytes > max_bytes_)
+        return;
+    if (const auto it = index_.find(e.path); it != index_.end()) {
+        bytes_ -= bytesOf(*it->second);
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+    lru_.push_front(std::move(e));
+    index_[lru_.front().path] = lru_.begin();
+    bytes_ += bytes;
+    while (bytes_ > max_bytes_) {
+        const auto& last = lru_.back();
+        bytes_ -= bytesOf(last);
+        index_.erase(last.path);
+        lru_.pop_back();
+    }
+}
+
+size_t MediaInfoCache::bytesOf(const Entry& e)
+{
+    return sizeof(CacheEntryHeader) + align8(e.path.size()) + align8(e.data_size);
+}
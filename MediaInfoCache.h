@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#pragma once
+#include "MediaInfoInternal.h"
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+    // read only
+    bool open(const char* path);
+    void close();
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+private:
+#if (_WIN32 + 0)
+    void* file_ = nullptr;
+    void* map_ = nullptr;
+#endif
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/*
+  Persistent media info cache of local files, keyed by (path, size, mtime). Values are MediaInfoSerialize() results.
+  The cache file is memory mapped, entries loaded from the file are read from the mapping. New entries are kept in memory,
+  and the file is rewritten in LRU order by flush(), which is called in dtor and after every 16 put().
+  Thread safe.
+ */
+class MediaInfoCache {
+public:
+    MediaInfoCache(const char* path, int64_t maxBytes);
+    ~MediaInfoCache(); // flush
+    // return false if url is not a local file, or not cached, or file is changed
+    bool get(const char* url, MediaInfoInternal* out);
+    void put(const char* url, const MediaInfoInternal& info);
+    bool flush();
+private:
+    struct Entry {
+        string path;
+        int64_t size;
+        int64_t mtime;
+        const char* data; // in mapped file, or owned
+        size_t data_size;
+        vector<char> owned;
+    };
+    using EntryList = list<Entry>; // most recently used first
+
+    void load();
+    bool flushLocked();
+    void insert(Entry&& e); // as most recently used and evict
+    static size_t bytesOf(const Entry& e);
+
+    mutex mtx_;
+    string path_;
+    size_t max_bytes_;
+    size_t bytes_ = 0;
+    bool dirty_ = false;
+    int puts_ = 0; // since last flush
+    EntryList lru_;
+    unordered_map<string, EntryList::iterator> index_;
+    MappedFile file_;
+};
@@ -1,21 +1,125 @@
 /*
- * Copyright (c) 2019-2023 WangBin <wbsecg1 at gmail.com>
+ * Copyright (c) 2019-2024 WangBin <wbsecg1 at gmail.com>
  */
 #pragma once
 #include "mdk/c/MediaInfo.h"
 #include "mdk/MediaInfo.h"
+#include <atomic>
+#include <memory>
+#include <thread>
 
 using namespace std;
 using namespace MDK_NS;
 
-struct MediaInfoInternal {
-    MediaInfo abi;
+/*
+  Data of media, stream and program info which is not in C structs. priv of C structs points to a record,
+  so C accessors never touch abi objects.
+ */
+struct MediaInfoRecord {
+    union {
+        mdkAudioCodecParameters audio;
+        mdkVideoCodecParameters video;
+        mdkSubtitleCodecParameters subtitle;
+    } codec;
+    const mdkStringMapEntry* metadata;
+    int nb_metadata;
+    const uint8_t* image; // video only
+    int image_size;
+};
+
+/*
+  A C MediaInfo in a single allocation: this header, then chapter, stream and program arrays, records(media, audio, video, subtitle, program),
+  metadata entries, program stream indices, strings and bytes.
+  Pointers are absolute. A memcpy of the whole arena is valid after MediaInfoRebase().
+  An arena is ref counted, and MUST NOT be modified if shared as a snapshot.
+ */
+struct MediaInfoArena {
+    uint32_t version; // layout version and pointer size
+    uint32_t nb_metadata;
+    uint32_t nb_ints;
+    atomic<int> refs;
+    uint64_t size; // total bytes
+    uint64_t base; // address when pointers are set
     mdkMediaInfo info;
-    vector<mdkChapterInfo> c;
-    vector<mdkAudioStreamInfo> a;
-    vector<mdkVideoStreamInfo> v;
-    vector<mdkSubtitleStreamInfo> s;
-    vector<mdkProgramInfo> p;
+};
+
+MediaInfoArena* MediaInfoRetain(MediaInfoArena* a);
+void MediaInfoRelease(MediaInfoArena* a);
+
+struct MediaInfoArenaDeleter {
+    void operator()(MediaInfoArena* a) const { MediaInfoRelease(a); }
+};
+
+struct MediaInfoInternal {
+    unique_ptr<MediaInfoArena, MediaInfoArenaDeleter> arena;
+
+    const mdkMediaInfo* info() const;
 };
 
 void MediaInfoToC(const MediaInfo& abi, MediaInfoInternal* out);
+// update values which can change without events, e.g. live stream duration, realtime bit rate. out MUST be converted from the same media
+void MediaInfoUpdateC(const MediaInfo& abi, MediaInfoInternal* out);
+// fix pointers of an arena copied from another address. return false if arena is invalid, e.g. broken data or version mismatch
+bool MediaInfoRebase(MediaInfoArena* arena, size_t size);
+// the arena bytes, out is overwritten
+void MediaInfoSerialize(const MediaInfoInternal& in, vector<char>& out);
+// load MediaInfoSerialize() result. data is copied. return false if data is invalid
+bool MediaInfoDeserialize(const void* data, size_t size, MediaInfoInternal* out);
+
+/*
+  The latest published media info arena. acquire() is lock free and returns a retained arena, or null if nothing is published.
+  publish() MUST be serialized by caller. A reader announces the arena it is retaining in a hazard slot, and publish() only waits for
+  readers holding the old arena, which finish in a few instructions. New readers never see the old arena, so publish() can not starve.
+ */
+class MediaInfoSnapshot {
+public:
+    ~MediaInfoSnapshot() { MediaInfoRelease(current_.load()); }
+
+    MediaInfoArena* acquire() {
+        auto& s = claim();
+        auto a = current_.load();
+        while (true) {
+            s.hazard.store(a);
+            const auto b = current_.load(); // a is not released if still current after it's announced
+            if (b == a)
+                break;
+            a = b;
+        }
+        MediaInfoRetain(a);
+        s.hazard.store(nullptr, memory_order_release);
+        s.busy.clear(memory_order_release);
+        return a;
+    }
+
+    // a is owned by snapshot
+    void publish(MediaInfoArena* a) {
+        const auto old = current_.exchange(a);
+        if (!old)
+            return;
+        for (auto& s : slots_) {
+            while (s.hazard.load() == old) // the reader may load old but not retain it yet
+                this_thread::yield();
+        }
+        MediaInfoRelease(old);
+    }
+private:
+    struct alignas(64) Slot {
+        atomic_flag busy = ATOMIC_FLAG_INIT;
+        atomic<MediaInfoArena*> hazard = nullptr;
+    };
+
+    Slot& claim() {
+        size_t i = hash<thread::id>()(this_thread::get_id());
+        while (true) {
+            auto& s = slots_[i++ % kSlots];
+            if (!s.busy.test_and_set(memory_order_acquire))
+                return s;
+            if (i % kSlots == 0)
+                this_thread::yield(); // more than kSlots readers
+        }
+    }
+
+    static constexpr size_t kSlots = 16;
+    atomic<MediaInfoArena*> current_ = nullptr;
+    Slot slots_[kSlots];
+};
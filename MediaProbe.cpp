@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#include "mdk/c/MediaProbe.h"
+#include "mdk/Player.h"
+#include "MediaInfoCache.h"
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace MDK_NS;
+
+// extra time to wait for prepare callback after player timeout, in case timeout callback does not abort loading
+static constexpr int64_t kTimeoutGrace = 1000;
+static constexpr int64_t kDefaultTimeout = 10000; // the same as Player
+
+struct ProbeItem {
+    int index = 0;
+    string url;
+    int64_t timeout = 0;
+    uint64_t gen = 0; // mdkMediaProbe.cancel_gen when added
+    mdkMediaProbeCallback cb{};
+};
+
+class ProbeWorker;
+
+struct mdkMediaProbe {
+    mutex mtx;
+    condition_variable cv; // items added or quit
+    condition_variable done_cv; // pending == 0
+    deque<ProbeItem> items;
+    int pending = 0; // queued and running items
+    bool quit = false;
+    atomic<uint64_t> cancel_gen = 0; // items added before cancel() have an old gen
+    shared_ptr<MediaInfoCache> cache;
+    vector<unique_ptr<ProbeWorker>> workers;
+
+    void cancel();
+};
+
+/*
+  A worker reuses a player to load media one by one. Loading is stopped in prepare callback, so no decoding is required.
+ */
+class ProbeWorker {
+public:
+    ProbeWorker(mdkMediaProbe* q) : q_(q), thread_(&ProbeWorker::run, this) {}
+
+    ~ProbeWorker() {
+        if (thread_.joinable())
+            thread_.join();
+        player_.setTimeout(0, nullptr);
+    }
+
+    // wake up if waiting for prepare callback
+    void cancel() {
+        const lock_guard<mutex> lock(mtx_);
+        cv_.notify_all();
+    }
+private:
+    void run() {
+        while (true) {
+            ProbeItem item;
+            shared_ptr<MediaInfoCache> cache;
+            {
+                unique_lock<mutex> lock(q_->mtx);
+                q_->cv.wait(lock, [this]{ return q_->quit || !q_->items.empty(); });
+                if (q_->items.empty())
+                    return;
+                item = std::move(q_->items.front());
+                q_->items.pop_front();
+                cache = q_->cache;
+            }
+            probe(item, cache.get());
+            {
+                const lock_guard<mutex> lock(q_->mtx);
+                if (--q_->pending == 0)
+                    q_->done_cv.notify_all();
+            }
+        }
+    }
+
+    bool canceled(const ProbeItem& item) const {
+        return q_->cancel_gen.load() != item.gen;
+    }
+
+    void probe(const ProbeItem& item, MediaInfoCache* cache) {
+        if (canceled(item)) {
+            item.cb.cb(item.index, item.url.data(), nullptr, MDK_MediaProbe_Canceled, item.cb.opaque);
+            return;
+        }
+        if (cache && cache->get(item.url.data(), &info_)) { // info_ is not accessed by player now
+            item.cb.cb(item.index, item.url.data(), info_.info(), 0, item.cb.opaque);
+            return;
+        }
+        const auto timeout = item.timeout > 0 ? item.timeout : kDefaultTimeout;
+        uint64_t seq = 0;
+        {
+            const lock_guard<mutex> lock(mtx_);
+            seq = ++seq_;
+            ready_ = false;
+        }
+        player_.setTimeout(timeout, [](int64_t){ return true; }); // abort loading
+        player_.setMedia(item.url.data());
+        player_.prepare(0, [this, seq](int64_t position, bool*){
+            const lock_guard<mutex> lock(mtx_);
+            if (seq != seq_) // late callback of a canceled or timed out item
+                return false;
+            if (position < 0) {
+                result_ = position < INT_MIN ? INT_MIN : int(position);
+            } else {
+                result_ = 0;
+                MediaInfoToC(player_.mediaInfo(), &info_);
+            }
+            ready_ = true;
+            cv_.notify_all();
+            return false; // unload immediately
+        });
+
+        int error = 0;
+        bool ready = false;
+        {
+            unique_lock<mutex> lock(mtx_);
+            cv_.wait_for(lock, chrono::milliseconds(timeout + kTimeoutGrace), [&]{ return ready_ || canceled(item); });
+            ready = ready_;
+            if (ready)
+                error = result_;
+            else if (canceled(item))
+                error = MDK_MediaProbe_Canceled;
+            else
+                error = MDK_MediaProbe_Timeout;
+            ++seq_; // info_ will not be touched by prepare callback
+        }
+        if (!ready) {
+            player_.set(State::Stopped);
+            player_.waitFor(State::Stopped);
+        }
+        if (cache && !error)
+            cache->put(item.url.data(), info_);
+        item.cb.cb(item.index, item.url.data(), error ? nullptr : info_.info(), error, item.cb.opaque);
+    }
+
+    mdkMediaProbe* q_;
+    Player player_;
+    mutex mtx_;
+    condition_variable cv_;
+    uint64_t seq_ = 0;
+    bool ready_ = false;
+    int result_ = 0;
+    MediaInfoInternal info_;
+    thread thread_; // MUST be the last
+};
+
+void mdkMediaProbe::cancel()
+{
+    cancel_gen++;
+    for (auto& w : workers)
+        w->cancel();
+}
+
+extern "C" {
+
+mdkMediaProbe* MDK_MediaProbe_new(int threads)
+{
+    if (threads <= 0)
+        threads = (int)thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+    auto q = new mdkMediaProbe();
+    q->workers.reserve(threads);
+    for (int i = 0; i < threads; ++i)
+        q->workers.push_back(make_unique<ProbeWorker>(q));
+    return q;
+}
+
+void MDK_MediaProbe_delete(mdkMediaProbe** pp)
+{
+    if (!pp || !*pp)
+        return;
+    auto q = *pp;
+    {
+        const lock_guard<mutex> lock(q->mtx);
+        q->quit = true;
+        q->cv.notify_all();
+    }
+    q->cancel();
+    q->workers.clear(); // join
+    q->cache.reset(); // flush
+    delete q;
+    *pp = nullptr;
+}
+
+void MDK_MediaProbe_probe(mdkMediaProbe* q, const char* const* urls, int count, int64_t timeout, mdkMediaProbeCallback cb)
+{
+    if (!urls || count <= 0 || !cb.cb)
+        return;
+    const lock_guard<mutex> lock(q->mtx);
+    const auto gen = q->cancel_gen.load();
+    for (int i = 0; i < count; ++i) {
+        ProbeItem item;
+        item.index = i;
+        item.url = urls[i] ? urls[i] : "";
+        item.timeout = timeout;
+        item.gen = gen;
+        item.cb = cb;
+        q->items.push_back(std::move(item));
+    }
+    q->pending += count;
+    q->cv.notify_all();
+}
+
+void MDK_MediaProbe_setCache(mdkMediaProbe* q, const char* path, int64_t maxBytes)
+{
+    shared_ptr<MediaInfoCache> cache;
+    if (path && *path)
+        cache = make_shared<MediaInfoCache>(path, maxBytes);
+    const lock_guard<mutex> lock(q->mtx);
+    q->cache.swap(cache); // old cache is flushed when running workers release it
+}
+
+void MDK_MediaProbe_cancel(mdkMediaProbe* q)
+{
+    q->cancel();
+}
+
+bool MDK_MediaProbe_waitFor(mdkMediaProbe* q, long timeout)
+{
+    unique_lock<mutex> lock(q->mtx);
+    if (timeout < 0) {
+        q->done_cv.wait(lock, [q]{ return q->pending == 0; });
+        return true;
+    }
+    return q->done_cv.wait_for(lock, chrono::milliseconds(timeout), [q]{ return q->pending == 0; });
+}
+
+} // extern "C"
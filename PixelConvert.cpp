@@ -0,0 +1,839 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#include "PixelConvert.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+# define CONVERT_X86 1
+# include <immintrin.h>
+# if (_MSC_VER + 0) && !defined(__clang__)
+#  include <intrin.h>
+# else
+#  include <cpuid.h>
+# endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+# define CONVERT_NEON 1
+# include <arm_neon.h>
+#endif
+
+#if (_MSC_VER + 0) && !defined(__clang__)
+# define TARGET(X) // msvc intrinsics do not require target options
+#else
+# define TARGET(X) __attribute__((target(X)))
+#endif
+
+using namespace std;
+
+enum class Layout { RGBA, BGRA, RGB };
+
+enum class ColorMatrix { Unknown, BT601, BT709, BT2020 };
+
+/*
+  Fixed point yuv to rgb coefficients and offsets of y and chroma.
+  8bit kernels: inputs minus offsets are scaled by 1 << kIn8, and multiplied by Q13 coefficients keeping the high 16 bits, i.e. results are Q4.
+  no intermediate value overflows 16 bits. coefficients are even, so neon vqdmulh with Q12 gives the same results.
+  P010 kernels use Q16 in 32bit, no product overflows 32 bits. simd kernels saturate results to 16 bits before packing to 8 bits, the same as clamp8.
+ */
+struct YuvCoeffs {
+    int y;
+    int rv;
+    int gu;
+    int gv;
+    int bu;
+    int yoff;
+    int coff;
+};
+
+static constexpr int kIn8 = 7;
+static constexpr int kQ8 = 4; // 13 + kIn8 - 16
+static constexpr int kQ16 = 16;
+
+static YuvCoeffs make_coeffs(ColorMatrix m, bool full, int bits)
+{
+    double kr = 0.299, kb = 0.114;
+    if (m == ColorMatrix::BT709) {
+        kr = 0.2126;
+        kb = 0.0722;
+    } else if (m == ColorMatrix::BT2020) {
+        kr = 0.2627;
+        kb = 0.0593;
+    }
+    const double kg = 1.0 - kr - kb;
+    // scale input bits to 8bit output
+    const double max = (1 << bits) - 1;
+    const double ys = full ? 255.0 / max : 255.0 / (219 << (bits - 8));
+    const double cs = full ? 255.0 / max : 255.0 / (224 << (bits - 8));
+    const auto fixed = [bits](double v) {
+        return bits > 8 ? (int)lround(v * (1 << kQ16)) : 2 * (int)lround(v * (1 << 12));
+    };
+    YuvCoeffs k;
+    k.y = fixed(ys);
+    k.rv = fixed(2 * (1 - kr) * cs);
+    k.gu = fixed(2 * kb * (1 - kb) / kg * cs);
+    k.gv = fixed(2 * kr * (1 - kr) / kg * cs);
+    k.bu = fixed(2 * (1 - kb) * cs);
+    k.yoff = full ? 0 : 16 << (bits - 8);
+    k.coff = 1 << (bits - 1);
+    return k;
+}
+
+// convert a row of 8bit yuv. u and v are half width if chroma is subsampled
+typedef void (*RowKernel)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const YuvCoeffs& k);
+// convert a row of msb aligned 10bit yuv, i.e. P010
+typedef void (*Row16Kernel)(const uint16_t* y, const uint16_t* u, const uint16_t* v, uint8_t* dst, int width, const YuvCoeffs& k);
+
+template<Layout L>
+static constexpr int bytes_per_pixel()
+{
+    return L == Layout::RGB ? 3 : 4;
+}
+
+static inline uint8_t clamp8(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : uint8_t(v));
+}
+
+template<Layout L>
+static inline void store_c(uint8_t* p, uint8_t r, uint8_t g, uint8_t b)
+{
+    if constexpr (L == Layout::BGRA) {
+        p[0] = b;
+        p[1] = g;
+        p[2] = r;
+    } else {
+        p[0] = r;
+        p[1] = g;
+        p[2] = b;
+    }
+    if constexpr (bytes_per_pixel<L>() == 4)
+        p[3] = 255;
+}
+
+// the same as _mm_mulhi_epi16
+static inline int mulhi(int a, int b)
+{
+    return (a * b) >> 16;
+}
+
+// pixels [x, width), bit exact with simd kernels
+template<Layout L, int Shift>
+static void row_c_from(const uint8_t* Y, const uint8_t* U, const uint8_t* V, uint8_t* dst, int x, int width, const YuvCoeffs& k)
+{
+    constexpr int bpp = bytes_per_pixel<L>();
+    for (; x < width; ++x) {
+        const int c = mulhi((Y[x] - k.yoff) * (1 << kIn8), k.y) + (1 << (kQ8 - 1));
+        const int d = (U[x >> Shift] - k.coff) * (1 << kIn8);
+        const int e = (V[x >> Shift] - k.coff) * (1 << kIn8);
+        store_c<L>(dst + x * bpp, clamp8((c + mulhi(e, k.rv)) >> kQ8), clamp8((c - mulhi(d, k.gu) - mulhi(e, k.gv)) >> kQ8), clamp8((c + mulhi(d, k.bu)) >> kQ8));
+    }
+}
+
+template<Layout L, int Shift>
+static void row_c(const uint8_t* Y, const uint8_t* U, const uint8_t* V, uint8_t* dst, int width, const YuvCoeffs& k)
+{
+    row_c_from<L, Shift>(Y, U, V, dst, 0, width, k);
+}
+
+// pixels [x, width) in 32bit math, bit exact with simd kernels
+template<Layout L, int Shift>
+static void row16_c_from(const uint16_t* Y, const uint16_t* U, const uint16_t* V, uint8_t* dst, int x, int width, const YuvCoeffs& k)
+{
+    constexpr int bpp = bytes_per_pixel<L>();
+    for (; x < width; ++x) {
+        const int c = k.y * ((Y[x] >> 6) - k.yoff) + (1 << (kQ16 - 1));
+        const int d = (U[x >> Shift] >> 6) - k.coff;
+        const int e = (V[x >> Shift] >> 6) - k.coff;
+        store_c<L>(dst + x * bpp, clamp8((c + k.rv * e) >> kQ16), clamp8((c - k.gu * d - k.gv * e) >> kQ16), clamp8((c + k.bu * d) >> kQ16));
+    }
+}
+
+template<Layout L, int Shift>
+static void row16_c(const uint16_t* Y, const uint16_t* U, const uint16_t* V, uint8_t* dst, int width, const YuvCoeffs& k)
+{
+    row16_c_from<L, Shift>(Y, U, V, dst, 0, width, k);
+}
+
+#if (CONVERT_X86 + 0)
+TARGET("sse4.1") static inline void yuv2rgb_sse(__m128i y, __m128i u, __m128i v, __m128i& r, __m128i& g, __m128i& b, const YuvCoeffs& k)
+{
+    const __m128i c = _mm_add_epi16(_mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(y, _mm_set1_epi16(k.yoff)), kIn8), _mm_set1_epi16(k.y)), _mm_set1_epi16(1 << (kQ8 - 1)));
+    const __m128i d = _mm_slli_epi16(_mm_sub_epi16(u, _mm_set1_epi16(k.coff)), kIn8);
+    const __m128i e = _mm_slli_epi16(_mm_sub_epi16(v, _mm_set1_epi16(k.coff)), kIn8);
+    r = _mm_srai_epi16(_mm_add_epi16(c, _mm_mulhi_epi16(e, _mm_set1_epi16(k.rv))), kQ8);
+    g = _mm_srai_epi16(_mm_sub_epi16(_mm_sub_epi16(c, _mm_mulhi_epi16(d, _mm_set1_epi16(k.gu))), _mm_mulhi_epi16(e, _mm_set1_epi16(k.gv))), kQ8);
+    b = _mm_srai_epi16(_mm_add_epi16(c, _mm_mulhi_epi16(d, _mm_set1_epi16(k.bu))), kQ8);
+}
+
+// store 16 pixels
+template<Layout L>
+TARGET("sse4.1") static inline void store_sse(uint8_t* dst, __m128i r, __m128i g, __m128i b)
+{
+    if constexpr (L == Layout::BGRA)
+        swap(r, b);
+    const __m128i a = _mm_set1_epi8(-1);
+    const __m128i rg0 = _mm_unpacklo_epi8(r, g);
+    const __m128i rg1 = _mm_unpackhi_epi8(r, g);
+    const __m128i ba0 = _mm_unpacklo_epi8(b, a);
+    const __m128i ba1 = _mm_unpackhi_epi8(b, a);
+    __m128i p0 = _mm_unpacklo_epi16(rg0, ba0);
+    __m128i p1 = _mm_unpackhi_epi16(rg0, ba0);
+    __m128i p2 = _mm_unpacklo_epi16(rg1, ba1);
+    __m128i p3 = _mm_unpackhi_epi16(rg1, ba1);
+    if constexpr (L != Layout::RGB) {
+        _mm_storeu_si128((__m128i*)dst, p0);
+        _mm_storeu_si128((__m128i*)(dst + 16), p1);
+        _mm_storeu_si128((__m128i*)(dst + 32), p2);
+        _mm_storeu_si128((__m128i*)(dst + 48), p3);
+        return;
+    }
+    const __m128i rgb = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    p0 = _mm_shuffle_epi8(p0, rgb);
+    p1 = _mm_shuffle_epi8(p1, rgb);
+    p2 = _mm_shuffle_epi8(p2, rgb);
+    p3 = _mm_shuffle_epi8(p3, rgb);
+    // 12 bytes each. the last 4 bytes of a store are overwritten by the next one, and the last store MUST not exceed 48 bytes
+    _mm_storeu_si128((__m128i*)dst, p0);
+    _mm_storeu_si128((__m128i*)(dst + 12), p1);
+    _mm_storeu_si128((__m128i*)(dst + 24), p2);
+    _mm_storel_epi64((__m128i*)(dst + 36), p3);
+    const int last = _mm_extract_epi32(p3, 2);
+    memcpy(dst + 44, &last, sizeof(last));
+}
+
+template<Layout L, int Shift>
+TARGET("sse4.1") static void row_sse41(const uint8_t* Y, const uint8_t* U, const uint8_t* V, uint8_t* dst, int width, const YuvCoeffs& k)
+{
+    constexpr int bpp = bytes_per_pixel<L>();
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y = _mm_loadu_si128((const __m128i*)(Y + x));
+        __m128i u, v;
+        if constexpr (Shift) {
+            u = _mm_loadl_epi64((const __m128i*)(U + x / 2));
+            v = _mm_loadl_epi64((const __m128i*)(V + x / 2));
+            u = _mm_unpacklo_epi8(u, u);
+            v = _mm_unpacklo_epi8(v, v);
+        } else {
+            u = _mm_loadu_si128((const __m128i*)(U + x));
+            v = _mm_loadu_si128((const __m128i*)(V + x));
+        }
+        __m128i r0, g0, b0, r1, g1, b1;
+        yuv2rgb_sse(_mm_cvtepu8_epi16(y), _mm_cvtepu8_epi16(u), _mm_cvtepu8_epi16(v), r0, g0, b0, k);
+        yuv2rgb_sse(_mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi8(u, zero), _mm_unpackhi_epi8(v, zero), r1, g1, b1, k);
+        store_sse<L>(dst + x * bpp, _mm_packus_epi16(r0, r1), _mm_packus_epi16(g0, g1), _mm_packus_epi16(b0, b1));
+    }
+    row_c_from<L, Shift>(Y, U, V, dst, x, width, k);
+}
+
+TARGET("avx2") static inline void yuv2rgb_avx2(__m256i y, __m256i u, __m256i v, __m256i& r, __m256i& g, __m256i& b, const YuvCoeffs& k)
+{
+    const __m256i c = _mm256_add_epi16(_mm256_mulhi_epi16(_mm256_slli_epi16(_mm256_sub_epi16(y, _mm256_set1_epi16(k.yoff)), kIn8), _mm256_set1_epi16(k.y)), _mm256_set1_epi16(1 << (kQ8 - 1)));
+    const __m256i d = _mm256_slli_epi16(_mm256_sub_epi16(u, _mm256_set1_epi16(k.coff)), kIn8);
+    const __m256i e = _mm256_slli_epi16(_mm256_sub_epi16(v, _mm256_set1_epi16(k.coff)), kIn8);
+    r = _mm256_srai_epi16(_mm256_add_epi16(c, _mm256_mulhi_epi16(e, _mm256_set1_epi16(k.rv))), kQ8);
+    g = _mm256_srai_epi16(_mm256_sub_epi16(_mm256_sub_epi16(c, _mm256_mulhi_epi16(d, _mm256_set1_epi16(k.gu))), _mm256_mulhi_epi16(e, _mm256_set1_epi16(k.gv))), kQ8);
+    b = _mm256_srai_epi16(_mm256_add_epi16(c, _mm256_mulhi_epi16(d, _mm256_set1_epi16(k.bu))), kQ8);
+}
+
+// 16 int16 to 16 uint8 in order
+TARGET("avx2") static inline __m128i pack_avx2(__m256i v)
+{
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08));
+}
+
+template<Layout L, int Shift>
+TARGET("avx2") static void row_avx2(const uint8_t* Y, const uint8_t* U, const uint8_t* V, uint8_t* dst, int width, const YuvCoeffs& k)
+{
+    constexpr int bpp = bytes_per_pixel<L>();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y = _mm_loadu_si128((const __m128i*)(Y + x));
+        __m128i u, v;
+        if constexpr (Shift) {
+            u = _mm_loadl_epi64((const __m128i*)(U + x / 2));
+            v = _mm_loadl_epi64((const __m128i*)(V + x / 2));
+            u = _mm_unpacklo_epi8(u, u);
+            v = _mm_unpacklo_epi8(v, v);
+        } else {
+            u = _mm_loadu_si128((const __m128i*)(U + x));
+            v = _mm_loadu_si128((const __m128i*)(V + x));
+        }
+        __m256i r, g, b;
+        yuv2rgb_avx2(_mm256_cvtepu8_epi16(y), _mm256_cvtepu8_epi16(u), _mm256_cvtepu8_epi16(v), r, g, b, k);
+        store_sse<L>(dst + x * bpp, pack_avx2(r), pack_avx2(g), pack_avx2(b));
+    }
+    row_c_from<L, Shift>(Y, U, V, dst, x, width, k);
+}
+
+// 4 pixels of 10bit values in 32bit lanes
+TARGET("sse4.1") static inline void yuv2rgb16_sse(__m128i y, __m128i u, __m128i v, __m128i& r, __m128i& g, __m128i& b, const YuvCoeffs& k)
+{
+    const __m128i c = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(y, _mm_set1_epi32(k.yoff)), _mm_set1_epi32(k.y)), _mm_set1_epi32(1 << (kQ16 - 1)));
+    const __m128i d = _mm_sub_epi32(u, _mm_set1_epi32(k.coff));
+    const __m128i e = _mm_sub_epi32(v, _mm_set1_epi32(k.coff));
+    r = _mm_srai_epi32(_mm_add_epi32(c, _mm_mullo_epi32(e, _mm_set1_epi32(k.rv))), kQ16);
+    g = _mm_srai_epi32(_mm_sub_epi32(_mm_sub_epi32(c, _mm_mullo_epi32(d, _mm_set1_epi32(k.gu))), _mm_mullo_epi32(e, _mm_set1_epi32(k.gv))), kQ16);
+    b = _mm_srai_epi32(_mm_add_epi32(c, _mm_mullo_epi32(d, _mm_set1_epi32(k.bu))), kQ16);
+}
+
+// 8 msb aligned 16bit values to 8 10bit values in 32bit lanes
+TARGET("sse4.1") static inline void widen16_sse(__m128i v, __m128i& lo, __m128i& hi)
+{
+    v = _mm_srli_epi16(v, 6);
+    lo = _mm_cvtepu16_epi32(v);
+    hi = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+}
+
+// u and v of 16 pixels, 8 values in each of u[2] and v[2]
+template<int Shift>
+TARGET("sse4.1") static inline void load_chroma16_sse(const uint16_t* U, const uint16_t* V, int x, __m128i u[2], __m128i v[2])
+{
+    if constexpr (Shift) {
+        const __m128i u8 = _mm_loadu_si128((const __m128i*)(U + x / 2));
+        const __m128i v8 = _mm_loadu_si128((const __m128i*)(V + x / 2));
+        u[0] = _mm_unpacklo_epi16(u8, u8);
+        u[1] = _mm_unpackhi_epi16(u8, u8);
+        v[0] = _mm_unpacklo_epi16(v8, v8);
+        v[1] = _mm_unpackhi_epi16(v8, v8);
+    } else {
+        u[0] = _mm_loadu_si128((const __m128i*)(U + x));
+        u[1] = _mm_loadu_si128((const __m128i*)(U + x + 8));
+        v[0] = _mm_loadu_si128((const __m128i*)(V + x));
+        v[1] = _mm_loadu_si128((const __m128i*)(V + x + 8));
+    }
+}
+
+template<Layout L, int Shift>
+TARGET("sse4.1") static void row16_sse41(const uint16_t* Y, const uint16_t* U, const uint16_t* V, uint8_t* dst, int width, const YuvCoeffs& k)
+{
+    constexpr int bpp = bytes_per_pixel<L>();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i u[2], v[2];
+        load_chroma16_sse<Shift>(U, V, x, u, v);
+        __m128i r[2], g[2], b[2];
+        for (int i = 0; i < 2; ++i) {
+            __m128i y0, y1, u0, u1, v0, v1, r0, g0, b0, r1, g1, b1;
+            widen16_sse(_mm_loadu_si128((const __m128i*)(Y + x + 8 * i)), y0, y1);
+            widen16_sse(u[i], u0, u1);
+            widen16_sse(v[i], v0, v1);
+            yuv2rgb16_sse(y0, u0, v0, r0, g0, b0, k);
+            yuv2rgb16_sse(y1, u1, v1, r1, g1, b1, k);
+            r[i] = _mm_packs_epi32(r0, r1);
+            g[i] = _mm_packs_epi32(g0, g1);
+            b[i] = _mm_packs_epi32(b0, b1);
+        }
+        store_sse<L>(dst + x * bpp, _mm_packus_epi16(r[0], r[1]), _mm_packus_epi16(g[0], g[1]), _mm_packus_epi16(b[0], b[1]));
+    }
+    row16_c_from<L, Shift>(Y, U, V, dst, x, width, k);
+}
+
+// 8 pixels of 10bit values in 32bit lanes
+TARGET("avx2") static inline void yuv2rgb16_avx2(__m256i y, __m256i u, __m256i v, __m256i& r, __m256i& g, __m256i& b, const YuvCoeffs& k)
+{
+    const __m256i c = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(y, _mm256_set1_epi32(k.yoff)), _mm256_set1_epi32(k.y)), _mm256_set1_epi32(1 << (kQ16 - 1)));
+    const __m256i d = _mm256_sub_epi32(u, _mm256_set1_epi32(k.coff));
+    const __m256i e = _mm256_sub_epi32(v, _mm256_set1_epi32(k.coff));
+    r = _mm256_srai_epi32(_mm256_add_epi32(c, _mm256_mullo_epi32(e, _mm256_set1_epi32(k.rv))), kQ16);
+    g = _mm256_srai_epi32(_mm256_sub_epi32(_mm256_sub_epi32(c, _mm256_mullo_epi32(d, _mm256_set1_epi32(k.gu))), _mm256_mullo_epi32(e, _mm256_set1_epi32(k.gv))), kQ16);
+    b = _mm256_srai_epi32(_mm256_add_epi32(c, _mm256_mullo_epi32(d, _mm256_set1_epi32(k.bu))), kQ16);
+}
+
+// 8 msb aligned 16bit values to 10bit values in 32bit lanes
+TARGET("avx2") static inline __m256i widen16_avx2(__m128i v)
+{
+    return _mm256_cvtepu16_epi32(_mm_srli_epi16(v, 6));
+}
+
+// 2x8 int32 to 16 int16 in order
+TARGET("avx2") static inline __m256i pack32_avx2(__m256i a, __m256i b)
+{
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8);
+}
+
+template<Layout L, int Shift>
+TARGET("avx2") static void row16_avx2(const uint16_t* Y, const uint16_t* U, const uint16_t* V, uint8_t* dst, int width, const YuvCoeffs& k)
+{
+    constexpr int bpp = bytes_per_pixel<L>();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i u[2], v[2];
+        load_chroma16_sse<Shift>(U, V, x, u, v);
+        __m256i r0, g0, b0, r1, g1, b1;
+        yuv2rgb16_avx2(widen16_avx2(_mm_loadu_si128((const __m128i*)(Y + x))), widen16_avx2(u[0]), widen16_avx2(v[0]), r0, g0, b0, k);
+        yuv2rgb16_avx2(widen16_avx2(_mm_loadu_si128((const __m128i*)(Y + x + 8))), widen16_avx2(u[1]), widen16_avx2(v[1]), r1, g1, b1, k);
+        store_sse<L>(dst + x * bpp, pack_avx2(pack32_avx2(r0, r1)), pack_avx2(pack32_avx2(g0, g1)), pack_avx2(pack32_avx2(b0, b1)));
+    }
+    row16_c_from<L, Shift>(Y, U, V, dst, x, width, k);
+}
+
+enum {
+    kCpuSSE41 = 1,
+    kCpuAVX2 = 1 << 1,
+};
+
+static void cpuid(unsigned r[4], unsigned leaf, unsigned sub)
+{
+# if (_MSC_VER + 0) && !defined(__clang__)
+    __cpuidex((int*)r, (int)leaf, (int)sub);
+# else
+    __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+# endif
+}
+
+static int cpu_features()
+{
+    unsigned r[4]{};
+    cpuid(r, 0, 0);
+    const auto max_leaf = r[0];
+    if (max_leaf < 1)
+        return 0;
+    cpuid(r, 1, 0);
+    int flags = 0;
+    if (r[2] & (1u << 19))
+        flags |= kCpuSSE41;
+    const bool osxsave = r[2] & (1u << 27);
+    const bool avx = r[2] & (1u << 28);
+    if (!osxsave || !avx || max_leaf < 7)
+        return flags;
+# if (_MSC_VER + 0) && !defined(__clang__)
+    const auto xcr0 = _xgetbv(0);
+# else
+    unsigned lo = 0, hi = 0;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    const uint64_t xcr0 = ((uint64_t)hi << 32) | lo;
+# endif
+    if ((xcr0 & 6) != 6) // os saves xmm and ymm
+        return flags;
+    cpuid(r, 7, 0);
+    if (r[1] & (1u << 5))
+        flags |= kCpuAVX2;
+    return flags;
+}
+#endif // (CONVERT_X86 + 0)
+
+#if (CONVERT_NEON + 0)
+static inline void yuv2rgb_neon(uint8x8_t y8, uint8x8_t u8, uint8x8_t v8, uint8x8_t& r, uint8x8_t& g, uint8x8_t& b, const YuvCoeffs& k)
+{
+    // vqdmulh(a, b / 2) is mulhi(a, b) for even b
+    const int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(y8));
+    const int16x8_t c = vqdmulhq_n_s16(vshlq_n_s16(vsubq_s16(y, vdupq_n_s16(k.yoff)), kIn8), k.y / 2);
+    const int16x8_t d = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), vdupq_n_s16(k.coff)), kIn8);
+    const int16x8_t e = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), vdupq_n_s16(k.coff)), kIn8);
+    // rounding shift adds 1 << (kQ8 - 1)
+    r = vqrshrun_n_s16(vaddq_s16(c, vqdmulhq_n_s16(e, k.rv / 2)), kQ8);
+    g = vqrshrun_n_s16(vsubq_s16(vsubq_s16(c, vqdmulhq_n_s16(d, k.gu / 2)), vqdmulhq_n_s16(e, k.gv / 2)), kQ8);
+    b = vqrshrun_n_s16(vaddq_s16(c, vqdmulhq_n_s16(d, k.bu / 2)), kQ8);
+}
+
+template<Layout L, int Shift>
+static void row_neon(const uint8_t* Y, const uint8_t* U, const uint8_t* V, uint8_t* dst, int width, const YuvCoeffs& k)
+{
+    constexpr int bpp = bytes_per_pixel<L>();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint8x16_t y = vld1q_u8(Y + x);
+        uint8x16_t u, v;
+        if constexpr (Shift) {
+            const uint8x8_t u8 = vld1_u8(U + x / 2);
+            const uint8x8_t v8 = vld1_u8(V + x / 2);
+            const uint8x8x2_t uu = vzip_u8(u8, u8);
+            const uint8x8x2_t vv = vzip_u8(v8, v8);
+            u = vcombine_u8(uu.val[0], uu.val[1]);
+            v = vcombine_u8(vv.val[0], vv.val[1]);
+        } else {
+            u = vld1q_u8(U + x);
+            v = vld1q_u8(V + x);
+        }
+        uint8x8_t r0, g0, b0, r1, g1, b1;
+        yuv2rgb_neon(vget_low_u8(y), vget_low_u8(u), vget_low_u8(v), r0, g0, b0, k);
+        yuv2rgb_neon(vget_high_u8(y), vget_high_u8(u), vget_high_u8(v), r1, g1, b1, k);
+        const uint8x16_t r = vcombine_u8(r0, r1);
+        const uint8x16_t g = vcombine_u8(g0, g1);
+        const uint8x16_t b = vcombine_u8(b0, b1);
+        if constexpr (L == Layout::RGB) {
+            vst3q_u8(dst + x * bpp, uint8x16x3_t{{r, g, b}});
+        } else if constexpr (L == Layout::BGRA) {
+            vst4q_u8(dst + x * bpp, uint8x16x4_t{{b, g, r, vdupq_n_u8(255)}});
+        } else {
+            vst4q_u8(dst + x * bpp, uint8x16x4_t{{r, g, b, vdupq_n_u8(255)}});
+        }
+    }
+    row_c_from<L, Shift>(Y, U, V, dst, x, width, k);
+}
+
+// 8 pixels of msb aligned 10bit values
+static inline void yuv2rgb16_neon(uint16x8_t y16, uint16x8_t u16, uint16x8_t v16, uint8x8_t& r, uint8x8_t& g, uint8x8_t& b, const YuvCoeffs& k)
+{
+    const int16x8_t y = vreinterpretq_s16_u16(vshrq_n_u16(y16, 6));
+    const int16x8_t u = vreinterpretq_s16_u16(vshrq_n_u16(u16, 6));
+    const int16x8_t v = vreinterpretq_s16_u16(vshrq_n_u16(v16, 6));
+    int16x4_t rgb[3][2];
+    for (int i = 0; i < 2; ++i) {
+        const int32x4_t y32 = vmovl_s16(i ? vget_high_s16(y) : vget_low_s16(y));
+        const int32x4_t c = vmlaq_n_s32(vdupq_n_s32(1 << (kQ16 - 1)), vsubq_s32(y32, vdupq_n_s32(k.yoff)), k.y);
+        const int32x4_t d = vsubq_s32(vmovl_s16(i ? vget_high_s16(u) : vget_low_s16(u)), vdupq_n_s32(k.coff));
+        const int32x4_t e = vsubq_s32(vmovl_s16(i ? vget_high_s16(v) : vget_low_s16(v)), vdupq_n_s32(k.coff));
+        rgb[0][i] = vqmovn_s32(vshrq_n_s32(vmlaq_n_s32(c, e, k.rv), kQ16));
+        rgb[1][i] = vqmovn_s32(vshrq_n_s32(vmlsq_n_s32(vmlsq_n_s32(c, d, k.gu), e, k.gv), kQ16));
+        rgb[2][i] = vqmovn_s32(vshrq_n_s32(vmlaq_n_s32(c, d, k.bu), kQ16));
+    }
+    r = vqmovun_s16(vcombine_s16(rgb[0][0], rgb[0][1]));
+    g = vqmovun_s16(vcombine_s16(rgb[1][0], rgb[1][1]));
+    b = vqmovun_s16(vcombine_s16(rgb[2][0], rgb[2][1]));
+}
+
+template<Layout L, int Shift>
+static void row16_neon(const uint16_t* Y, const uint16_t* U, const uint16_t* V, uint8_t* dst, int width, const YuvCoeffs& k)
+{
+    constexpr int bpp = bytes_per_pixel<L>();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint16x8_t u[2], v[2];
+        if constexpr (Shift) {
+            const uint16x8_t u8 = vld1q_u16(U + x / 2);
+            const uint16x8_t v8 = vld1q_u16(V + x / 2);
+            const uint16x8x2_t uu = vzipq_u16(u8, u8);
+            const uint16x8x2_t vv = vzipq_u16(v8, v8);
+            u[0] = uu.val[0];
+            u[1] = uu.val[1];
+            v[0] = vv.val[0];
+            v[1] = vv.val[1];
+        } else {
+            u[0] = vld1q_u16(U + x);
+            u[1] = vld1q_u16(U + x + 8);
+            v[0] = vld1q_u16(V + x);
+            v[1] = vld1q_u16(V + x + 8);
+        }
+        uint8x8_t r0, g0, b0, r1, g1, b1;
+        yuv2rgb16_neon(vld1q_u16(Y + x), u[0], v[0], r0, g0, b0, k);
+        yuv2rgb16_neon(vld1q_u16(Y + x + 8), u[1], v[1], r1, g1, b1, k);
+        const uint8x16_t r = vcombine_u8(r0, r1);
+        const uint8x16_t g = vcombine_u8(g0, g1);
+        const uint8x16_t b = vcombine_u8(b0, b1);
+        if constexpr (L == Layout::RGB) {
+            vst3q_u8(dst + x * bpp, uint8x16x3_t{{r, g, b}});
+        } else if constexpr (L == Layout::BGRA) {
+            vst4q_u8(dst + x * bpp, uint8x16x4_t{{b, g, r, vdupq_n_u8(255)}});
+        } else {
+            vst4q_u8(dst + x * bpp, uint8x16x4_t{{r, g, b, vdupq_n_u8(255)}});
+        }
+    }
+    row16_c_from<L, Shift>(Y, U, V, dst, x, width, k);
+}
+#endif // (CONVERT_NEON + 0)
+
+template<Layout L, int Shift>
+static RowKernel select_kernel()
+{
+#if (CONVERT_X86 + 0)
+    static const int cpu = cpu_features();
+    if (cpu & kCpuAVX2)
+        return row_avx2<L, Shift>;
+    if (cpu & kCpuSSE41)
+        return row_sse41<L, Shift>;
+#elif (CONVERT_NEON + 0)
+    return row_neon<L, Shift>;
+#endif
+    return row_c<L, Shift>;
+}
+
+template<Layout L>
+static RowKernel select_kernel(int shift)
+{
+    return shift ? select_kernel<L, 1>() : select_kernel<L, 0>();
+}
+
+template<Layout L, int Shift>
+static Row16Kernel select_kernel16()
+{
+#if (CONVERT_X86 + 0)
+    static const int cpu = cpu_features();
+    if (cpu & kCpuAVX2)
+        return row16_avx2<L, Shift>;
+    if (cpu & kCpuSSE41)
+        return row16_sse41<L, Shift>;
+#elif (CONVERT_NEON + 0)
+    return row16_neon<L, Shift>;
+#endif
+    return row16_c<L, Shift>;
+}
+
+template<Layout L>
+static Row16Kernel select_kernel16(int shift)
+{
+    return shift ? select_kernel16<L, 1>() : select_kernel16<L, 0>();
+}
+
+// average of 2x2 pixels
+template<typename T>
+static void downscale(const T* s0, const T* s1, T* d, int width)
+{
+    for (int x = 0; x < width; ++x)
+        d[x] = T((s0[2*x] + s0[2*x+1] + s1[2*x] + s1[2*x+1] + 2) >> 2);
+}
+
+template<typename T>
+static void split(const T* s, T* u, T* v, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        u[x] = s[2*x];
+        v[x] = s[2*x+1];
+    }
+}
+
+static int option_int(const char* key, int defaultValue)
+{
+    if (const auto v = get_if<int>(&GetGlobalOption(key)))
+        return *v;
+    return defaultValue;
+}
+
+static const char* option_string(const char* key)
+{
+    if (const auto v = get_if<string>(&GetGlobalOption(key)))
+        return v->data();
+    return "";
+}
+
+// color info of a frame is not available in C api, "videoframe.convert.matrix" MUST be set to enable the fast path
+static ColorMatrix option_matrix()
+{
+    const auto m = option_string("videoframe.convert.matrix");
+    if (strcmp(m, "bt601") == 0)
+        return ColorMatrix::BT601;
+    if (strcmp(m, "bt709") == 0)
+        return ColorMatrix::BT709;
+    if (strcmp(m, "bt2020") == 0)
+        return ColorMatrix::BT2020;
+    return ColorMatrix::Unknown;
+}
+
+class Converter {
+public:
+    bool init(const VideoFrame& frame, PixelFormat format, int width, int height) {
+        src_ = frame.format();
+        if (src_ != PixelFormat::NV12 && src_ != PixelFormat::YUV420P && src_ != PixelFormat::P010LE)
+            return false;
+        const auto matrix = option_matrix();
+        if (matrix == ColorMatrix::Unknown)
+            return false;
+        const int fw = frame.width();
+        const int fh = frame.height();
+        if (fw <= 0 || fh <= 0)
+            return false;
+        if (width <= 0)
+            width = fw;
+        if (height <= 0)
+            height = fh;
+        if (width == fw && height == fh)
+            half_ = false;
+        else if (width * 2 == fw && height * 2 == fh)
+            half_ = true;
+        else
+            return false;
+        const int planes = src_ == PixelFormat::YUV420P ? 3 : 2;
+        for (int i = 0; i < planes; ++i) {
+            const auto buf = frame.buffer(i);
+            if (!buf || !buf->constData()) // not in host memory
+                return false;
+            data_[i] = buf->constData();
+            strides_[i] = frame.bytesPerLine(i);
+        }
+        const bool full = strcmp(option_string("videoframe.convert.range"), "full") == 0;
+        const bool p010 = src_ == PixelFormat::P010LE;
+        coeffs_ = make_coeffs(matrix, full, p010 ? 10 : 8);
+        // chroma of half size output is not subsampled
+        const int shift = half_ ? 0 : 1;
+        switch (format) {
+        case PixelFormat::RGBA:
+        case PixelFormat::RGBX:
+            kernel_ = select_kernel<Layout::RGBA>(shift);
+            kernel16_ = select_kernel16<Layout::RGBA>(shift);
+            bpp_ = 4;
+            break;
+        case PixelFormat::BGRA:
+        case PixelFormat::BGRX:
+            kernel_ = select_kernel<Layout::BGRA>(shift);
+            kernel16_ = select_kernel16<Layout::BGRA>(shift);
+            bpp_ = 4;
+            break;
+        case PixelFormat::RGB24:
+            kernel_ = select_kernel<Layout::RGB>(shift);
+            kernel16_ = select_kernel16<Layout::RGB>(shift);
+            bpp_ = 3;
+            break;
+        default:
+            return false;
+        }
+        width_ = width;
+        height_ = height;
+        return true;
+    }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int bytesPerPixel() const { return bpp_; }
+
+    // rows [y0, y1) of dst
+    void convert(uint8_t* dst, int stride, int y0, int y1) const {
+        if (src_ == PixelFormat::P010LE)
+            convert16(dst, stride, y0, y1);
+        else
+            convert8(dst, stride, y0, y1);
+    }
+private:
+    const uint8_t* row(int plane, int y) const { return data_[plane] + (size_t)y * strides_[plane]; }
+    const uint16_t* row16(int plane, int y) const { return reinterpret_cast<const uint16_t*>(row(plane, y)); }
+
+    // rows of y, u and v, reused by conversions in the same thread(the caller or a slice pool thread)
+    template<typename T>
+    T* scratch() const {
+        const int cw = half_ ? width_ : (width_ + 1) / 2;
+        thread_local vector<uint8_t> buf;
+        const size_t bytes = sizeof(T) * (width_ + cw * 2);
+        if (buf.size() < bytes)
+            buf.resize(bytes);
+        return reinterpret_cast<T*>(buf.data());
+    }
+
+    void convert8(uint8_t* dst, int stride, int y0, int y1) const {
+        const int cw = half_ ? width_ : (width_ + 1) / 2;
+        const auto ty = scratch<uint8_t>();
+        const auto tu = ty + width_;
+        const auto tv = tu + cw;
+        int chroma_row = -1;
+        for (int y = y0; y < y1; ++y) {
+            const int cy = half_ ? y : y / 2;
+            const uint8_t* Y = ty;
+            const uint8_t* U = tu;
+            const uint8_t* V = tv;
+            if (half_)
+                downscale(row(0, 2*y), row(0, 2*y+1), ty, width_);
+            else
+                Y = row(0, y);
+            if (src_ == PixelFormat::YUV420P) {
+                U = row(1, cy);
+                V = row(2, cy);
+            } else if (cy != chroma_row) {
+                split(row(1, cy), tu, tv, cw);
+            }
+            chroma_row = cy;
+            kernel_(Y, U, V, dst + (size_t)y * stride, width_, coeffs_);
+        }
+    }
+
+    // 10bit values are used by the matrix, not truncated to 8bit
+    void convert16(uint8_t* dst, int stride, int y0, int y1) const {
+        const int cw = half_ ? width_ : (width_ + 1) / 2;
+        const auto ty = scratch<uint16_t>();
+        const auto tu = ty + width_;
+        const auto tv = tu + cw;
+        int chroma_row = -1;
+        for (int y = y0; y < y1; ++y) {
+            const int cy = half_ ? y : y / 2;
+            const uint16_t* Y = ty;
+            if (half_)
+                downscale(row16(0, 2*y), row16(0, 2*y+1), ty, width_);
+            else
+                Y = row16(0, y);
+            if (cy != chroma_row)
+                split(row16(1, cy), tu, tv, cw);
+            chroma_row = cy;
+            kernel16_(Y, tu, tv, dst + (size_t)y * stride, width_, coeffs_);
+        }
+    }
+
+    PixelFormat src_ = PixelFormat::Unknown;
+    bool half_ = false;
+    int width_ = 0;
+    int height_ = 0;
+    int bpp_ = 0;
+    const uint8_t* data_[3]{};
+    int strides_[3]{};
+    YuvCoeffs coeffs_{};
+    RowKernel kernel_ = nullptr;
+    Row16Kernel kernel16_ = nullptr;
+};
+
+static constexpr int kDefaultMinPixels = 3840 * 2160;
+static constexpr int kMinSliceRows = 16;
+
+// shared by all conversions. null if frame is small or single-threaded
+static shared_ptr<ThreadPool> slice_pool(int64_t pixels)
+{
+    if (pixels < option_int("videoframe.convert.min_pixels", kDefaultMinPixels))
+        return nullptr;
+    int threads = option_int("videoframe.convert.threads", 0);
+    if (threads <= 0)
+        threads = (int)thread::hardware_concurrency();
+    if (threads <= 1)
+        return nullptr;
+    static mutex mtx;
+    static shared_ptr<ThreadPool> pool;
+    const lock_guard<mutex> lock(mtx);
+    if (!pool || pool->threads() != threads - 1) // the calling thread converts a slice too
+        pool = make_shared<ThreadPool>(threads - 1); // old pool is destroyed when running conversions are done
+    return pool;
+}
+
+// horizontal slices in the shared pool for large frames
+static void convert(const Converter& c, uint8_t* dst, int stride)
+{
+    const auto pool = slice_pool((int64_t)c.width() * c.height());
+    int slices = pool ? pool->threads() + 1 : 1;
+    if (slices > c.height() / kMinSliceRows)
+        slices = c.height() / kMinSliceRows;
+    if (slices <= 1) {
+        c.convert(dst, stride, 0, c.height());
+        return;
+    }
+    const int h = c.height();
+    pool->parallelFor(slices, [&](int i) {
+        c.convert(dst, stride, int((int64_t)h * i / slices), int((int64_t)h * (i + 1) / slices));
+    });
+}
+
+bool PixelConvertSupported(const VideoFrame& frame, PixelFormat format, int width, int height)
+{
+    Converter c;
+    return c.init(frame, format, width, height);
+}
+
+bool PixelConvert(const VideoFrame& frame, PixelFormat format, int width, int height, uint8_t* dst, int stride)
+{
+    Converter c;
+    if (!dst || !c.init(frame, format, width, height))
+        return false;
+    if (stride <= 0)
+        stride = c.width() * c.bytesPerPixel();
+    convert(c, dst, stride);
+    return true;
+}
+
+VideoFrame PixelConvert(const VideoFrame& frame, PixelFormat format, int width, int height)
+{
+    Converter c;
+    if (!c.init(frame, format, width, height))
+        return {};
+    const int stride = (c.width() * c.bytesPerPixel() + 31) & ~31;
+    auto data = (uint8_t*)malloc((size_t)stride * c.height());
+    if (!data)
+        return {};
+    convert(c, data, stride);
+    VideoFrame out(c.width(), c.height(), format);
+    out.addBuffer(data, stride, data, [](void** pBuf) {
+        free(*pBuf);
+        *pBuf = nullptr;
+    }, 0);
+    out.setTimestamp(frame.timestamp());
+    return out;
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#pragma once
+#include "mdk/VideoFrame.h"
+#include <cstdint>
+
+using namespace MDK_NS;
+
+/*
+  Host memory fast path of VideoFrame::to() for NV12, YUV420P and P010LE to RGBA, BGRA and RGB24,
+  in the same size or exactly half size. Color info of a frame is not available in C api, so the fast path is enabled only if the app declares
+  the color matrix via global option "videoframe.convert.matrix"(bt601, bt709, bt2020), and range via "videoframe.convert.range"(limited, full).
+  Rows are converted by SSE4.1, AVX2 or NEON kernels selected at runtime, and a C kernel otherwise.
+  Large frames are split into horizontal slices converted in a shared thread pool, see global options "videoframe.convert.*".
+ */
+// false if frame is not in host memory, or conversion is not supported. width, height <= 0: frame size
+bool PixelConvertSupported(const VideoFrame& frame, PixelFormat format, int width = -1, int height = -1);
+// convert to packed rgb dst. return false if not supported
+bool PixelConvert(const VideoFrame& frame, PixelFormat format, int width, int height, uint8_t* dst, int stride);
+// a new frame with the same timestamp, or an invalid frame if not supported
+VideoFrame PixelConvert(const VideoFrame& frame, PixelFormat format, int width = -1, int height = -1);
@@ -10,17 +10,34 @@
 #include "mdk/VideoFrame.h"
 #include "mdk/RenderAPI.h"
 #include "MediaInfoInternal.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
 #include <cstring>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 using namespace std;
 using namespace MDK_NS;
 
 extern mdkVideoFrameAPI* MDK_VideoFrame_toC(const VideoFrame& frame);
 extern VideoFrame MDK_VideoFrame_fromC(mdkVideoFrameAPI* p);
-extern unique_ptr<RenderAPI> from_c(MDK_RenderAPI type, void* data);
+extern void MDK_VideoFrame_setC(mdkVideoFrameAPI* p, const VideoFrame& frame);
+extern int MDK_VideoFrame_withRef(VideoFrame& frame, int (*cb)(mdkVideoFrameRef*, int, void*), int track, void* opaque);
+extern RenderAPI* from_c(MDK_RenderAPI type, void* data, unique_ptr<RenderAPI>& out, bool update);
+extern PixelFormat fromC(MDK_PixelFormat fmt);
+extern bool MDK_VideoFrame_toBuffersC(const VideoFrame& src, PixelFormat fmt, int width, int height, uint8_t* const* data, int* strides);
 
 static inline MediaType fromC(MDK_MediaType t)
 {
@@ -32,8 +49,815 @@ static inline MediaType fromC(MDK_MediaType t)
     }
 }
 
+/*
+  mdkVideoFrameAPI objects for onVideo callback. An object is only used during a callback, so the pool size is
+  the max number of concurrent callbacks(video tracks), and no allocation in steady state.
+ */
+class VideoFrameAPIPool {
+public:
+    VideoFrameAPIPool() {
+        free_.reserve(kMaxFree);
+    }
+
+    ~VideoFrameAPIPool() {
+        for (auto f : free_)
+            mdkVideoFrameAPI_delete(&f);
+    }
+
+    mdkVideoFrameAPI* acquire(const VideoFrame& frame) {
+        if (!frame && frame.timestamp() != TimestampEOS) // the same as MDK_VideoFrame_toC
+            return nullptr;
+        mdkVideoFrameAPI* f = nullptr;
+        {
+            const lock_guard<mutex> lock(mtx_);
+            if (!free_.empty()) {
+                f = free_.back();
+                free_.pop_back();
+            }
+        }
+        if (!f) {
+            misses_.fetch_add(1, memory_order_relaxed);
+            return MDK_VideoFrame_toC(frame);
+        }
+        hits_.fetch_add(1, memory_order_relaxed);
+        MDK_VideoFrame_setC(f, frame);
+        return f;
+    }
+
+    void recycle(mdkVideoFrameAPI* f) {
+        if (!f)
+            return;
+        MDK_VideoFrame_setC(f, VideoFrame()); // release frame data now
+        {
+            const lock_guard<mutex> lock(mtx_);
+            if (free_.size() < kMaxFree) {
+                free_.push_back(f);
+                return;
+            }
+        }
+        mdkVideoFrameAPI_delete(&f);
+    }
+
+    int stats(int64_t* hits, int64_t* misses) {
+        if (hits)
+            *hits = hits_.load(memory_order_relaxed);
+        if (misses)
+            *misses = misses_.load(memory_order_relaxed);
+        const lock_guard<mutex> lock(mtx_);
+        return (int)free_.size();
+    }
+private:
+    static constexpr size_t kMaxFree = 8;
+    mutex mtx_;
+    vector<mdkVideoFrameAPI*> free_;
+    atomic<int64_t> hits_ = 0;
+    atomic<int64_t> misses_ = 0;
+};
+
+/*
+  Bounded lock free MPSC queue of events(Vyukov's bounded queue). Producers are threads raising events, no allocation when pushing.
+  A new event is dropped if the queue is full.
+ */
+class EventQueue {
+public:
+    EventQueue(size_t capacity) : mask_(capacity - 1), slots_(new Slot[capacity]) {
+        assert((capacity & mask_) == 0 && "capacity must be power of 2");
+        for (size_t i = 0; i < capacity; ++i)
+            slots_[i].seq.store(i, memory_order_relaxed);
+    }
+
+    bool push(const MediaEvent& e, int category_id) {
+        auto pos = tail_.load(memory_order_relaxed);
+        while (true) {
+            auto& s = slots_[pos & mask_];
+            const auto diff = (intptr_t)s.seq.load(memory_order_acquire) - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    fill(s.e, e, category_id);
+                    s.seq.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) { // full
+                dropped_.fetch_add(1, memory_order_relaxed);
+                return false;
+            } else {
+                pos = tail_.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // single consumer
+    int pop(mdkEventRecord* out, int count) {
+        int n = 0;
+        while (n < count) {
+            auto& s = slots_[head_ & mask_];
+            if (s.seq.load(memory_order_acquire) != head_ + 1)
+                break;
+            out[n++] = s.e;
+            s.seq.store(head_ + mask_ + 1, memory_order_release);
+            ++head_;
+        }
+        return n;
+    }
+
+    int takeDropped() {
+        return (int)dropped_.exchange(0, memory_order_relaxed);
+    }
+private:
+    static void fill(mdkEventRecord& out, const MediaEvent& e, int category_id) {
+        out.error = e.error;
+        out.category = category_id;
+        out.video.width = e.video.width;
+        out.video.height = e.video.height;
+        const auto len = e.detail.size() < sizeof(out.detail) ? e.detail.size() : sizeof(out.detail) - 1;
+        memcpy(out.detail, e.detail.data(), len);
+        out.detail[len] = 0;
+    }
+
+    struct alignas(64) Slot {
+        atomic<size_t> seq;
+        mdkEventRecord e;
+    };
+
+    const size_t mask_;
+    unique_ptr<Slot[]> slots_;
+    alignas(64) atomic<size_t> tail_ = 0;
+    alignas(64) size_t head_ = 0;
+    atomic<int64_t> dropped_ = 0;
+};
+
+struct mdkPlayer;
+
+/*
+  Checks buffered duration of a player, and calls back when a watermark is reached. Checked by WatermarkTimer.
+ */
+class BufferWatermarks {
+public:
+    BufferWatermarks(mdkPlayer* p, int64_t low, int64_t high, int interval, mdkBufferWatermarkCallback cb);
+    // waits for running check
+    ~BufferWatermarks();
+private:
+    friend class WatermarkTimer;
+    void check();
+
+    mdkPlayer* p_;
+    const int64_t low_;
+    const int64_t high_;
+    const chrono::milliseconds interval_;
+    const mdkBufferWatermarkCallback cb_;
+    int mark_ = -1; // reported MDK_BufferWatermark, timer thread only
+    chrono::steady_clock::time_point due_; // guarded by timer
+};
+
+/*
+  A thread checks watermarks of all players at their intervals, instead of a thread per player. Started at the first watcher.
+ */
+class WatermarkTimer {
+public:
+    static WatermarkTimer& instance() {
+        static WatermarkTimer t;
+        return t;
+    }
+
+    ~WatermarkTimer() {
+        {
+            const lock_guard<mutex> lock(mtx_);
+            quit_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    void add(BufferWatermarks* w) {
+        {
+            const lock_guard<mutex> lock(mtx_);
+            w->due_ = chrono::steady_clock::now(); // the first check reports the current watermark
+            watchers_.push_back(w);
+            if (!thread_.joinable())
+                thread_ = thread(&WatermarkTimer::run, this);
+        }
+        cv_.notify_all();
+    }
+
+    // MUST not be called in a watermark callback
+    void remove(BufferWatermarks* w) {
+        unique_lock<mutex> lock(mtx_);
+        watchers_.erase(find(watchers_.begin(), watchers_.end(), w));
+        cv_.wait(lock, [this, w]{ return running_ != w; });
+    }
+private:
+    void run() {
+        unique_lock<mutex> lock(mtx_);
+        while (!quit_) {
+            if (watchers_.empty()) {
+                cv_.wait(lock);
+                continue;
+            }
+            const auto w = *min_element(watchers_.begin(), watchers_.end(), [](auto a, auto b) { return a->due_ < b->due_; });
+            const auto now = chrono::steady_clock::now();
+            if (w->due_ > now) {
+                cv_.wait_until(lock, w->due_); // woken by add() or quit
+                continue;
+            }
+            w->due_ = now + w->interval_;
+            running_ = w;
+            lock.unlock(); // cb can append buffer
+            w->check();
+            lock.lock();
+            running_ = nullptr;
+            cv_.notify_all();
+        }
+    }
+
+    mutex mtx_;
+    condition_variable cv_; // watchers_ changed, quit, or a check finished
+    vector<BufferWatermarks*> watchers_;
+    BufferWatermarks* running_ = nullptr;
+    bool quit_ = false;
+    thread thread_;
+};
+
+BufferWatermarks::BufferWatermarks(mdkPlayer* p, int64_t low, int64_t high, int interval, mdkBufferWatermarkCallback cb)
+    : p_(p), low_(low), high_(high), interval_(interval), cb_(cb)
+{
+    WatermarkTimer::instance().add(this);
+}
+
+BufferWatermarks::~BufferWatermarks()
+{
+    WatermarkTimer::instance().remove(this);
+}
+
+/*
+  Latency histograms of mdkPlayerAPI functions of a player. A histogram is created at the first call of a function.
+  Log-linear buckets: values < 8ns are exact, and every power of 2 above is split into 8 buckets, i.e. relative error < 12.5%.
+ */
+class ApiLatency {
+public:
+    static constexpr int kSlots = sizeof(mdkPlayerAPI) / sizeof(void*);
+
+    ~ApiLatency() {
+        for (auto& h : slots_)
+            delete h.load();
+    }
+
+    static bool enabled() {
+        const auto v = get_if<int>(&GetGlobalOption("profiler.api"));
+        return v && *v;
+    }
+
+    // names are the same for all players
+    static void setName(int slot, const char* name) {
+        names()[slot].store(name, memory_order_relaxed);
+    }
+
+    void record(int slot, int64_t ns) {
+        auto h = slots_[slot].load(memory_order_acquire);
+        if (!h) {
+            auto n = new Histogram();
+            if (slots_[slot].compare_exchange_strong(h, n, memory_order_acq_rel))
+                h = n;
+            else
+                delete n;
+        }
+        h->buckets[bucket(ns)].fetch_add(1, memory_order_relaxed);
+        h->total.fetch_add(ns, memory_order_relaxed);
+        auto v = h->min.load(memory_order_relaxed);
+        while (ns < v && !h->min.compare_exchange_weak(v, ns, memory_order_relaxed)) {}
+        v = h->max.load(memory_order_relaxed);
+        while (ns > v && !h->max.compare_exchange_weak(v, ns, memory_order_relaxed)) {}
+    }
+
+    int stats(mdkApiLatency* out, int count, bool reset) {
+        int n = 0;
+        for (int i = 0; i < kSlots; ++i) {
+            const auto h = slots_[i].load(memory_order_acquire);
+            if (!h)
+                continue;
+            uint32_t b[kBuckets];
+            int64_t calls = 0;
+            for (int j = 0; j < kBuckets; ++j) {
+                b[j] = reset ? h->buckets[j].exchange(0, memory_order_relaxed) : h->buckets[j].load(memory_order_relaxed);
+                calls += b[j];
+            }
+            if (calls == 0)
+                continue;
+            if (out && n < count) {
+                auto& s = out[n];
+                s.slot = i;
+                s.name = names()[i].load(memory_order_relaxed);
+                s.count = calls;
+                s.totalNs = reset ? h->total.exchange(0, memory_order_relaxed) : h->total.load(memory_order_relaxed);
+                s.minNs = reset ? h->min.exchange(INT64_MAX, memory_order_relaxed) : h->min.load(memory_order_relaxed);
+                s.maxNs = reset ? h->max.exchange(0, memory_order_relaxed) : h->max.load(memory_order_relaxed);
+                s.p50Ns = percentile(b, calls, 0.5, s.minNs, s.maxNs);
+                s.p90Ns = percentile(b, calls, 0.9, s.minNs, s.maxNs);
+                s.p99Ns = percentile(b, calls, 0.99, s.minNs, s.maxNs);
+                s.p999Ns = percentile(b, calls, 0.999, s.minNs, s.maxNs);
+            } else if (reset) {
+                h->total = 0;
+                h->min = INT64_MAX;
+                h->max = 0;
+            }
+            ++n;
+        }
+        return n;
+    }
+private:
+    static constexpr int kSubBits = 3;
+    static constexpr int kMaxBits = 41; // ~36 min
+    static constexpr int kBuckets = (kMaxBits - kSubBits + 1) << kSubBits;
+
+    struct Histogram {
+        atomic<uint32_t> buckets[kBuckets]{};
+        atomic<int64_t> total = 0;
+        atomic<int64_t> min = INT64_MAX;
+        atomic<int64_t> max = 0;
+    };
+
+    static atomic<const char*>* names() {
+        static atomic<const char*> n[kSlots]{};
+        return n;
+    }
+
+    static int bucket(int64_t ns) {
+        uint64_t v = ns < 0 ? 0 : (uint64_t)ns;
+        if (v >= (1ULL << kMaxBits))
+            v = (1ULL << kMaxBits) - 1;
+        if (v < (1 << kSubBits))
+            return (int)v;
+        int msb = 63;
+        while (!(v >> msb))
+            --msb;
+        const int shift = msb - kSubBits;
+        return ((shift + 1) << kSubBits) + (int)((v >> shift) & ((1 << kSubBits) - 1));
+    }
+
+    // middle of bucket range
+    static int64_t bucketValue(int i) {
+        if (i < (1 << kSubBits))
+            return i;
+        const int shift = (i >> kSubBits) - 1;
+        const int64_t low = int64_t((1 << kSubBits) + (i & ((1 << kSubBits) - 1))) << shift;
+        return low + ((int64_t(1) << shift) >> 1);
+    }
+
+    static int64_t percentile(const uint32_t* b, int64_t calls, double q, int64_t minNs, int64_t maxNs) {
+        const auto rank = (int64_t)(q * calls + 0.999999);
+        int64_t n = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            n += b[i];
+            if (n >= rank)
+                return std::clamp(bucketValue(i), minNs, std::max(minNs, maxNs));
+        }
+        return maxNs;
+    }
+
+    atomic<Histogram*> slots_[kSlots]{};
+};
+
+/*
+  Render target of MDK_RenderAPI_Host. Frames are queued in video thread, and converted into a ring of host buffers in renderVideo().
+ */
+class HostRenderer {
+public:
+    explicit HostRenderer(const mdkHostRenderAPI* api) {
+        // type has struct size if versioned. fields not in an older struct are 0
+        const int struct_sz = ((api->type << 2) >> 18) & 0xffff;
+        const bool is_size = (api->type >> 30) & 0b11;
+        memset(&api_, 0, sizeof(api_));
+        memcpy(&api_, api, is_size ? std::min<size_t>(struct_sz, sizeof(api_)) : sizeof(api_));
+        api_.type = MDK_RenderAPI_Host;
+        format_ = api_.format == MDK_PixelFormat_Unknown ? PixelFormat::RGBA : fromC(api_.format);
+        switch (format_) {
+        case PixelFormat::RGBA:
+        case PixelFormat::RGBX:
+        case PixelFormat::BGRA:
+        case PixelFormat::BGRX:
+        case PixelFormat::RGB24:
+            break;
+        default: // planar formats are not supported by the single plane buffer
+            format_ = PixelFormat::RGBA;
+            api_.format = MDK_PixelFormat_RGBA;
+            break;
+        }
+        if (api_.buffers <= 0)
+            api_.buffers = kDefaultBuffers;
+        api_.data = nullptr;
+        api_.stride = 0;
+        api_.outWidth = 0;
+        api_.outHeight = 0;
+        api_.timestamp = -1;
+        buffers_.resize(api_.buffers);
+    }
+
+    ~HostRenderer() {
+        for (const auto& b : buffers_)
+            free(b.data);
+    }
+
+    mdkHostRenderAPI* api() { return &api_; }
+
+    // drop the oldest frame if queue is full
+    void push(const VideoFrame& frame) {
+        if (!frame)
+            return;
+        const lock_guard<mutex> lock(mtx_);
+        if ((int)frames_.size() >= api_.buffers)
+            frames_.pop_front();
+        frames_.push_back(frame);
+    }
+
+    // render thread
+    double render() {
+        VideoFrame frame;
+        {
+            const lock_guard<mutex> lock(mtx_);
+            if (frames_.empty())
+                return -1;
+            frame = std::move(frames_.front());
+            frames_.pop_front();
+        }
+        const int w = api_.width > 0 ? api_.width : frame.width();
+        const int h = api_.height > 0 ? api_.height : frame.height();
+        int stride = (VideoFormat(format_).bytesPerLine(w, 0) + kAlignment - 1) & ~(kAlignment - 1);
+        const size_t size = (size_t)stride * h;
+        // reallocate the oldest buffer only, others can be still in use after output size changes
+        auto& buf = buffers_[next_];
+        if (buf.size < size) {
+            free(buf.data);
+            buf.data = (uint8_t*)malloc(size);
+            buf.size = buf.data ? size : 0;
+        }
+        if (!buf.data || !MDK_VideoFrame_toBuffersC(frame, format_, w, h, &buf.data, &stride))
+            return -1;
+        next_ = (next_ + 1) % api_.buffers;
+        api_.data = buf.data;
+        api_.stride = stride;
+        api_.outWidth = w;
+        api_.outHeight = h;
+        api_.timestamp = frame.timestamp();
+        return api_.timestamp;
+    }
+private:
+    static constexpr int kDefaultBuffers = 3;
+    static constexpr int kAlignment = 64;
+    mutex mtx_;
+    deque<VideoFrame> frames_;
+    mdkHostRenderAPI api_;
+    PixelFormat format_;
+    struct Buffer {
+        uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+    vector<Buffer> buffers_;
+    int next_ = 0;
+};
+
 struct mdkPlayer : Player{
     MediaInfoInternal media_info;
+    uint64_t media_info_gen = 0; // generation of media_info
+    atomic<uint64_t> info_gen = 1; // increased when media is (un)loaded or changed by events
+    CallbackToken info_event_token = 0;
+    CallbackToken info_status_token = 0;
+    VideoFrameAPIPool video_frames;
+    mutex info_snapshot_mtx; // serialize info_snapshot updates
+    atomic<int> info_snapshot_state = 0; // 0: disabled, 1: publishing the first snapshot, 2: published. enabled by the first mediaInfoSnapshot() call
+    MediaInfoSnapshot info_snapshot;
+    mutex event_queue_mtx; // setEventQueue() and pollEvents()
+    shared_ptr<EventQueue> event_queue;
+    CallbackToken event_queue_token = 0;
+    atomic<int64_t> appended_bytes = 0; // since setMedia() or setMediaForType()
+    mutex watermarks_mtx;
+    unique_ptr<BufferWatermarks> watermarks;
+    mutex video_mtx; // onVideo() callback and host renderers
+    mdkVideoCallback video_cb{};
+    mdkVideoRefCallback video_ref_cb{};
+    mdkRenderCallback render_cb{};
+    unordered_map<void*, unique_ptr<HostRenderer>> host_renderers;
+    // converted from C api by vo_opaque. player keeps the pointer, so it's alive until api is reset
+    unordered_map<void*, pair<int, unique_ptr<RenderAPI>>> render_apis;
+    unique_ptr<ApiLatency> latency; // if "profiler.api" is enabled
+    struct Listener {
+        CallbackToken token;
+        uint64_t mask; // bits of category ids
+        function<bool(const MediaEvent&, int category_id)> cb;
+    };
+    using Listeners = vector<Listener>;
+    mutex listeners_mtx;
+    // event listeners added by C api, also called for events raised in C layer, e.g. "snapshot" of snapshotToFile().
+    // copy on write, so dispatch() only copies the pointer
+    shared_ptr<const Listeners> listeners = make_shared<const Listeners>();
+    CallbackToken listener_token = 0; // the last token of listeners
+    mutex dispatcher_mtx; // never held by dispatch()
+    CallbackToken dispatcher_token = 0; // player listener calling dispatch(). 0: not added
+    struct RaiseTarget {
+        RaiseTarget(mdkPlayer* player) : p(player) {}
+        mutex mtx; // held while raising, so resetting p waits for a running raise()
+        mdkPlayer* p;
+    };
+    // raise events from threads not owned by player, e.g. snapshot thread, which can outlive player. reset in mdkPlayerAPI_delete()
+    shared_ptr<RaiseTarget> raise_target = make_shared<RaiseTarget>(this);
+
+    void addListener(uint64_t mask, function<bool(const MediaEvent&, int)>&& cb, CallbackToken* token) {
+        {
+            const lock_guard<mutex> lock(dispatcher_mtx);
+            if (!dispatcher_token) {
+                onEvent([this](const MediaEvent& e){
+                    return dispatch(e);
+                }, &dispatcher_token);
+            }
+        }
+        const lock_guard<mutex> lock(listeners_mtx);
+        auto ls = make_shared<Listeners>(*listeners);
+        ls->push_back({++listener_token, mask, std::move(cb)});
+        listeners = std::move(ls);
+        if (token)
+            *token = listener_token;
+    }
+
+    // remove all if token is null, including player listeners
+    void removeListener(CallbackToken* token) {
+        if (!token) {
+            const lock_guard<mutex> lock(dispatcher_mtx);
+            onEvent(nullptr, nullptr);
+            dispatcher_token = 0;
+        }
+        const lock_guard<mutex> lock(listeners_mtx);
+        if (!token) {
+            listeners = make_shared<const Listeners>();
+            return;
+        }
+        auto ls = make_shared<Listeners>(*listeners);
+        ls->erase(remove_if(ls->begin(), ls->end(), [token](const auto& l){ return l.token == *token; }), ls->end());
+        listeners = std::move(ls);
+    }
+
+    /*
+      Dispatch an event raised in C layer to internal handlers and C api listeners, the same order as player dispatching.
+      Player can not dispatch it, so handlers added by Player::onEvent() directly, e.g. in mdk runtime or modules, do not receive it.
+     */
+    void raise(const MediaEvent& e);
+    // call listeners in order until one returns true. category id is computed once, and only for listeners in mask
+    bool dispatch(const MediaEvent& e);
+
+    void bufferLevel(mdkBufferLevel* level) const {
+        level->bytes = 0;
+        level->duration = buffered(&level->bytes);
+        level->appendedBytes = appended_bytes;
+    }
+};
+
+void BufferWatermarks::check()
+{
+    mdkBufferLevel level;
+    p_->bufferLevel(&level);
+    int m = mark_;
+    if (level.duration <= low_)
+        m = MDK_BufferWatermark_Low;
+    else if (level.duration >= high_)
+        m = MDK_BufferWatermark_High;
+    if (m == mark_)
+        return;
+    mark_ = m;
+    cb_.cb(MDK_BufferWatermark(mark_), &level, cb_.opaque);
+}
+
+// converted in lock, so the last published is the latest
+static void publishMediaInfoLocked(mdkPlayer* p)
+{
+    MediaInfoInternal info;
+    MediaInfoToC(p->mediaInfo(), &info);
+    p->info_snapshot.publish(info.arena.release());
+}
+
+// mediaInfoSnapshot() only acquires the snapshot published here
+static void mediaInfoChanged(mdkPlayer* p)
+{
+    p->info_gen++;
+    if (p->info_snapshot_state.load(memory_order_acquire) == 0)
+        return;
+    const lock_guard<mutex> lock(p->info_snapshot_mtx);
+    publishMediaInfoLocked(p);
+}
+
+// events of player and C layer
+static void internalEvent(mdkPlayer* p, const MediaEvent& e)
+{
+    if (e.category == "metadata" || (e.category == "decoder.video" && e.detail == "size"))
+        mediaInfoChanged(p);
+    if (TraceEnabled()) {
+        char detail[64];
+        snprintf(detail, sizeof(detail), "%s: %s", e.category.data(), e.detail.data());
+        TraceInstant("event", "MediaEvent", p, e.error, detail);
+    }
+}
+
+void mdkPlayer::raise(const MediaEvent& e)
+{
+    internalEvent(this, e);
+    dispatch(e);
+}
+
+bool mdkPlayer::dispatch(const MediaEvent& e)
+{
+    shared_ptr<const Listeners> ls;
+    {
+        const lock_guard<mutex> lock(listeners_mtx);
+        ls = listeners;
+    }
+    if (ls->empty())
+        return false;
+    const int id = MDK_EventCategoryId(e.category.data());
+    const auto bit = MDK_EVENT_CATEGORY_BIT(id);
+    for (const auto& l : *ls) {
+        if ((l.mask & bit) && l.cb(e, id))
+            return true;
+    }
+    return false;
+}
+
+// internal listeners, MUST be added again if user clears all listeners
+static void watchMediaInfoEvents(mdkPlayer* p)
+{
+    p->onEvent([p](const MediaEvent& e){
+        internalEvent(p, e);
+        return false;
+    }, &p->info_event_token);
+}
+
+static void watchMediaInfoStatus(mdkPlayer* p)
+{
+    p->onMediaStatus([p](MediaStatus oldValue, MediaStatus newValue){
+        if ((int(oldValue) ^ int(newValue)) & (MDK_MediaStatus_Unloaded|MDK_MediaStatus_Loaded|MDK_MediaStatus_Invalid))
+            mediaInfoChanged(p);
+        return true;
+    }, &p->info_status_token);
+}
+
+static void to_c(const MediaEvent& e, int category_id, mdkMediaEvent& me)
+{
+    me.error = e.error;
+    me.category = e.category.data();
+    me.detail = e.detail.data();
+    me.decoder.stream = e.decoder.stream;
+    me.video.width = e.video.width;
+    me.video.height = e.video.height;
+    me.category_id = category_id;
+}
+
+// the queue is owned by listener, so it's alive when listener is running
+static void watchEventQueue(mdkPlayer* p, shared_ptr<EventQueue> q)
+{
+    p->addListener(MDK_EVENT_CATEGORY_ALL, [q](const MediaEvent& e, int id){
+        q->push(e, id);
+        return false;
+    }, &p->event_queue_token);
+}
+
+// mdkPlayerAPI function FN at Slot with latency recorded
+template<int Slot, auto FN> struct Timed;
+template<int Slot, typename R, typename... Args, R (*FN)(mdkPlayer*, Args...)>
+struct Timed<Slot, FN> {
+    static R call(mdkPlayer* p, Args... args) {
+        const Scope s{p};
+        return FN(p, args...);
+    }
+private:
+    struct Scope {
+        mdkPlayer* p;
+        const chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        ~Scope() {
+            p->latency->record(Slot, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count());
+        }
+    };
+};
+
+static int onVideoFrame(mdkPlayer* p, VideoFrame& frame, int track)
+{
+    mdkVideoCallback cb;
+    mdkVideoRefCallback ref_cb;
+    {
+        const lock_guard<mutex> lock(p->video_mtx);
+        cb = p->video_cb;
+        ref_cb = p->video_ref_cb;
+    }
+    if (!cb.opaque && !ref_cb.opaque)
+        return 0;
+    const auto t0 = TraceEnabled() ? TraceNow() : 0;
+    int ret = 0;
+    if (cb.opaque) {
+        auto f = p->video_frames.acquire(frame);
+        auto f0 = f;
+        ret = cb.cb(&f, track, cb.opaque);
+        if (f == f0) {
+            p->video_frames.recycle(f);
+        } else {
+            frame = MDK_VideoFrame_fromC(f); // f0 is owned by user now
+            mdkVideoFrameAPI_delete(&f);
+        }
+    }
+    if (ref_cb.opaque)
+        ret = MDK_VideoFrame_withRef(frame, ref_cb.cb, track, ref_cb.opaque);
+    if (t0 > 0)
+        TraceComplete("video", "onVideo", p, t0, int64_t(frame.timestamp() * 1000.0));
+    return ret;
+}
+
+// frames are delivered to host renderers after onVideo() callback
+static void updateVideoHook(mdkPlayer* p)
+{
+    bool hook = false;
+    {
+        const lock_guard<mutex> lock(p->video_mtx);
+        hook = p->video_cb.opaque || p->video_ref_cb.opaque || !p->host_renderers.empty();
+    }
+    if (!hook) {
+        p->onFrame<VideoFrame>(nullptr);
+        return;
+    }
+    p->onFrame<VideoFrame>([p](VideoFrame& frame, int track){
+        const auto ret = onVideoFrame(p, frame, track);
+        mdkRenderCallback cb;
+        vector<void*> vos;
+        {
+            const lock_guard<mutex> lock(p->video_mtx);
+            if (p->host_renderers.empty())
+                return ret;
+            for (auto& i : p->host_renderers) {
+                i.second->push(frame);
+                vos.push_back(i.first);
+            }
+            cb = p->render_cb;
+        }
+        if (cb.opaque) { // render callback may call renderVideo()
+            for (auto vo : vos)
+                cb.cb(vo, cb.opaque);
+        }
+        return ret;
+    });
+}
+
+static constexpr int kSnapshotAlignment = 64;
+static constexpr int kSnapshotEncodeThreads = 2;
+
+static int snapshot_stride(int width)
+{
+    return (width * 4 + kSnapshotAlignment - 1) & ~(kSnapshotAlignment - 1);
+}
+
+// encode snapshot files of all batches, instead of a snapshot thread per player
+static ThreadPool& snapshot_encoder()
+{
+    static ThreadPool pool(std::max(1, std::min(kSnapshotEncodeThreads, (int)thread::hardware_concurrency())));
+    return pool;
+}
+
+/*
+  Shared by snapshot callbacks of a batch. Renderer buffers are views of arena slices owned by batch, and referenced by
+  aliasing shared_ptrs, so no allocation per entry.
+ */
+struct SnapshotBatch : enable_shared_from_this<SnapshotBatch> {
+    deque<Buffer2DView> views; // emplace only, stable addresses
+    vector<mdkSnapshotBatchResult> results;
+    vector<string> files;
+    atomic<int> pending = 0;
+    mdkSnapshotBatchCallback cb{};
+
+    void done() {
+        if (--pending == 0)
+            cb.cb(results.data(), (int)results.size(), cb.opaque);
+    }
+
+    // in player snapshot thread
+    void onSnapshot(int i, const Player::SnapshotRequest* req, double frameTime) {
+        auto& res = results[i];
+        res.frameTime = frameTime;
+        auto& q = res.request;
+        if (!req || !req->buf || req->width != q.width || req->height != q.height) {
+            q.data = nullptr;
+            done();
+            return;
+        }
+        const auto data = req->buf->constData();
+        if (data != q.data) { // not rendered into arena
+            for (int y = 0; y < q.height; ++y)
+                memcpy(q.data + (size_t)y * q.stride, data + (size_t)y * req->stride, (size_t)q.width * 4);
+        }
+        if (files[i].empty()) {
+            done();
+            return;
+        }
+        snapshot_encoder().run([self = shared_from_this(), i] {
+            auto& res = self->results[i];
+            const auto& q = res.request;
+            VideoFrame frame(q.width, q.height, PixelFormat::BGRA);
+            frame.addBuffer(q.data, q.stride, nullptr, nullptr, 0);
+            res.saved = frame.save(self->files[i].c_str());
+            self->done();
+        });
+    }
 };
 
 extern "C" {
@@ -56,11 +880,15 @@ void MDK_Player_setChannelVolume(mdkPlayer* p, float value, int channel)
 void MDK_Player_setMedia(mdkPlayer* p, const char* url)
 {
     p->setMedia(url);
+    p->info_gen++;
+    p->appended_bytes = 0;
 }
 
 void MDK_Player_setMediaForType(mdkPlayer* p, const char* url, MDK_MediaType type)
 {
     p->setMedia(url, fromC(type));
+    p->info_gen++;
+    p->appended_bytes = 0;
 }
 
 const char* MDK_Player_url(mdkPlayer* p)
@@ -134,19 +962,56 @@ void MDK_Player_setTimeout(mdkPlayer* p, int64_t value, mdkTimeoutCallback cb)
 
 void MDK_Player_prepare(mdkPlayer* p, int64_t startPosition, mdkPrepareCallback cb, MDKSeekFlag flag)
 {
-    if (!cb.opaque) {
+    const auto span = TraceEnabled() ? TraceNewId() : 0; // prepare() can be called again before callback
+    if (span)
+        TraceAsyncBegin("player", "prepare", p, span, startPosition);
+    if (!cb.opaque && !span) {
         p->prepare(startPosition, nullptr, SeekFlag(flag));
         return;
     }
-    p->prepare(startPosition, [cb](int64_t position, bool* boost){
+    p->prepare(startPosition, [p, cb, span](int64_t position, bool* boost){
+        if (span)
+            TraceAsyncEnd("player", "prepare", p, span, position);
+        if (!cb.opaque)
+            return true;
         return cb.cb(position, boost, cb.opaque);
     }, SeekFlag(flag));
 }
 
 const mdkMediaInfo* MDK_Player_mediaInfo(mdkPlayer* p)
 {
-    MediaInfoToC(p->mediaInfo(), &p->media_info);
-    return &p->media_info.info;
+    const auto gen = p->info_gen.load(); // load before conversion, so changes during conversion will be applied in the next call
+    if (gen == p->media_info_gen) {
+        MediaInfoUpdateC(p->mediaInfo(), &p->media_info);
+    } else {
+        MediaInfoToC(p->mediaInfo(), &p->media_info);
+        p->media_info_gen = gen;
+    }
+    return p->media_info.info();
+}
+
+const mdkMediaInfo* MDK_Player_mediaInfoSnapshot(mdkPlayer* p)
+{
+    if (p->info_snapshot_state.load(memory_order_acquire) != 2) {
+        const lock_guard<mutex> lock(p->info_snapshot_mtx);
+        if (p->info_snapshot_state.load(memory_order_relaxed) == 0) {
+            p->info_snapshot_state.store(1, memory_order_release); // a change from now on is published again after this one
+            publishMediaInfoLocked(p);
+            p->info_snapshot_state.store(2, memory_order_release);
+        }
+    }
+    const auto a = p->info_snapshot.acquire();
+    return a ? &a->info : nullptr;
+}
+
+bool MDK_Player_mediaInfoChanged(mdkPlayer* p, uint64_t* generation)
+{
+    const auto gen = p->info_gen.load();
+    if (!generation)
+        return true;
+    const auto changed = *generation != gen;
+    *generation = gen;
+    return changed;
 }
 
 void MDK_Player_setState(mdkPlayer* p, MDK_State value)
@@ -184,6 +1049,7 @@ void MDK_Player_onMediaStatusChanged(mdkPlayer* p, mdkMediaStatusChangedCallback
 {
     if (!cb.opaque) {
         p->onMediaStatus(nullptr);
+        watchMediaInfoStatus(p);
         return;
     }
     p->onMediaStatus([cb](MediaStatus old, MediaStatus value){
@@ -195,6 +1061,8 @@ void MDK_Player_onMediaStatus(mdkPlayer* p, mdkMediaStatusCallback cb, MDK_Callb
 {
     if (!cb.opaque) {
         p->onMediaStatus(nullptr, token);
+        if (!token)
+            watchMediaInfoStatus(p);
         return;
     }
     p->onMediaStatus([cb](MediaStatus old, MediaStatus value){
@@ -251,16 +1119,53 @@ void MDK_Player_scale(mdkPlayer* p, float x, float y, void* vo_opaque)
 
 void MDK_Player_setRenderAPI(mdkPlayer* p, mdkRenderAPI* api, void* vo_opaque)
 {
-    p->setRenderAPI(from_c(*reinterpret_cast<MDK_RenderAPI*>(api), api).get(), vo_opaque);
+    const auto type = api ? *reinterpret_cast<MDK_RenderAPI*>(api) : MDK_RenderAPI_Invalid;
+    const bool host = (type & 0xffff) == MDK_RenderAPI_Host;
+    bool changed = false;
+    {
+        const lock_guard<mutex> lock(p->video_mtx);
+        changed = p->host_renderers.erase(vo_opaque) > 0;
+        if (host)
+            p->host_renderers[vo_opaque] = make_unique<HostRenderer>(reinterpret_cast<mdkHostRenderAPI*>(api));
+    }
+    if (host || changed)
+        updateVideoHook(p);
+    if (host)
+        return;
+    if (!api) {
+        p->setRenderAPI(nullptr, vo_opaque);
+        p->render_apis.erase(vo_opaque);
+        return;
+    }
+    auto& cached = p->render_apis[vo_opaque];
+    const bool update = cached.first == (type & 0xffff);
+    unique_ptr<RenderAPI> old; // type changed. released after player takes the new one
+    if (!update)
+        old = std::move(cached.second);
+    cached.first = type & 0xffff;
+    p->setRenderAPI(from_c(type, api, cached.second, update), vo_opaque);
 }
 
 mdkRenderAPI* MDK_Player_renderAPI(mdkPlayer* p, void* vo_opaque)
 {
+    {
+        const lock_guard<mutex> lock(p->video_mtx);
+        if (const auto it = p->host_renderers.find(vo_opaque); it != p->host_renderers.end())
+            return reinterpret_cast<mdkRenderAPI*>(it->second->api());
+    }
     return reinterpret_cast<mdkRenderAPI*>(p->renderAPI(vo_opaque));
 }
 
 double MDK_Player_renderVideo(mdkPlayer* p, void* vo_opaque)
 {
+    HostRenderer* host = nullptr;
+    {
+        const lock_guard<mutex> lock(p->video_mtx);
+        if (const auto it = p->host_renderers.find(vo_opaque); it != p->host_renderers.end())
+            host = it->second.get();
+    }
+    if (host) // alive until setRenderAPI() for vo_opaque, which is not thread safe
+        return host->render();
     return p->renderVideo(vo_opaque);
 }
 
@@ -271,30 +1176,38 @@ void MDK_Player_setBackgroundColor(mdkPlayer* p, float r, float g, float b, floa
 
 void MDK_Player_setRenderCallback(mdkPlayer* p, mdkRenderCallback cb)
 {
+    {
+        const lock_guard<mutex> lock(p->video_mtx);
+        p->render_cb = cb;
+    }
     if (!cb.opaque) {
         p->setRenderCallback(nullptr);
         return;
     }
-    p->setRenderCallback([cb](void* vo_opaque){
+    p->setRenderCallback([p, cb](void* vo_opaque){
+        const auto t0 = TraceEnabled() ? TraceNow() : 0;
         cb.cb(vo_opaque, cb.opaque);
+        if (t0 > 0)
+            TraceComplete("render", "renderCallback", p, t0);
     });
 }
 
 void MDK_Player_onVideo(mdkPlayer* p, mdkVideoCallback cb)
 {
-    if (!cb.opaque) {
-        p->onFrame<VideoFrame>(nullptr);
-        return;
+    {
+        const lock_guard<mutex> lock(p->video_mtx);
+        p->video_cb = cb;
     }
-    p->onFrame<VideoFrame>([cb](VideoFrame& frame, int track){
-        auto f = MDK_VideoFrame_toC(frame);
-        auto f0 = f;
-        auto ret = cb.cb(&f, track, cb.opaque);
-        if (f != f0)
-            frame = MDK_VideoFrame_fromC(f);
-        mdkVideoFrameAPI_delete(&f);
-        return ret;
-    });
+    updateVideoHook(p);
+}
+
+void MDK_Player_onVideoRef(mdkPlayer* p, mdkVideoRefCallback cb)
+{
+    {
+        const lock_guard<mutex> lock(p->video_mtx);
+        p->video_ref_cb = cb;
+    }
+    updateVideoHook(p);
 }
 
 void MDK_Player_onAudio(mdkPlayer*);
@@ -306,12 +1219,21 @@ int64_t MDK_Player_position(mdkPlayer* p)
 
 bool MDK_Player_seekWithFlags(mdkPlayer* p, int64_t pos, MDK_SeekFlag flags, mdkSeekCallback cb)
 {
-    if (!cb.opaque) {
+    const auto span = TraceEnabled() ? TraceNewId() : 0; // seeks can overlap
+    if (span)
+        TraceAsyncBegin("player", "seek", p, span, pos);
+    if (!cb.opaque && !span) {
         return p->seek(pos, SeekFlag(flags), nullptr);
     }
-    return p->seek(pos, SeekFlag(flags), [cb](int64_t value){
-        cb.cb(value, cb.opaque);
+    const bool ok = p->seek(pos, SeekFlag(flags), [p, cb, span](int64_t value){
+        if (span)
+            TraceAsyncEnd("player", "seek", p, span, value);
+        if (cb.opaque)
+            cb.cb(value, cb.opaque);
     });
+    if (!ok && span) // callback is not called
+        TraceAsyncEnd("player", "seek", p, span, -1);
+    return ok;
 }
 
 bool MDK_Player_seek(mdkPlayer* p, int64_t pos, mdkSeekCallback cb)
@@ -360,22 +1282,65 @@ bool MDK_Player_switchBitrateSingleConnection(mdkPlayer* p, const char *url, Swi
     });
 }
 
+static void addEventListener(mdkPlayer* p, mdkMediaEventCallback cb, uint64_t mask, MDK_CallbackToken* token)
+{
+    p->addListener(mask, [cb](const MediaEvent& e, int id){
+        mdkMediaEvent me{};
+        to_c(e, id, me);
+        return cb.cb(&me, cb.opaque);
+    }, token);
+}
+
 void MDK_Player_onEvent(mdkPlayer* p, mdkMediaEventCallback cb, MDK_CallbackToken* token)
 {
     if (!cb.opaque) {
-        p->onEvent(nullptr, token);
+        p->removeListener(token);
+        if (!token) {
+            watchMediaInfoEvents(p);
+            const lock_guard<mutex> lock(p->event_queue_mtx);
+            if (p->event_queue)
+                watchEventQueue(p, p->event_queue);
+        }
         return;
     }
-    p->onEvent([cb](const MediaEvent& e){
-        mdkMediaEvent me{};
-        me.error = e.error;
-        me.category = e.category.data();
-        me.detail = e.detail.data();
-        me.decoder.stream = e.decoder.stream;
-        me.video.width = e.video.width;
-        me.video.height = e.video.height;
-        return cb.cb(&me, cb.opaque);
-    }, token);
+    addEventListener(p, cb, MDK_EVENT_CATEGORY_ALL, token);
+}
+
+void MDK_Player_onEventMask(mdkPlayer* p, mdkMediaEventCallback cb, uint64_t mask, MDK_CallbackToken* token)
+{
+    if (!cb.opaque) {
+        MDK_Player_onEvent(p, cb, token);
+        return;
+    }
+    addEventListener(p, cb, mask, token);
+}
+
+void MDK_Player_setEventQueue(mdkPlayer* p, int capacity)
+{
+    const lock_guard<mutex> lock(p->event_queue_mtx);
+    if (p->event_queue) {
+        p->removeListener(&p->event_queue_token);
+        p->event_queue_token = 0;
+        p->event_queue.reset();
+    }
+    if (capacity <= 0)
+        return;
+    size_t n = 1;
+    while (n < (size_t)capacity)
+        n <<= 1;
+    p->event_queue = make_shared<EventQueue>(n);
+    watchEventQueue(p, p->event_queue);
+}
+
+int MDK_Player_pollEvents(mdkPlayer* p, mdkEventRecord* events, int count, int* dropped)
+{
+    const lock_guard<mutex> lock(p->event_queue_mtx);
+    const auto& q = p->event_queue;
+    if (dropped)
+        *dropped = q ? q->takeDropped() : 0;
+    if (!q || !events || count <= 0)
+        return 0;
+    return q->pop(events, count);
 }
 
 void MDK_Player_snapshot(mdkPlayer* p, mdkSnapshotRequest* request, mdkSnapshotCallback cb, void* vo_opaque)
@@ -408,6 +1373,39 @@ void MDK_Player_snapshot(mdkPlayer* p, mdkSnapshotRequest* request, mdkSnapshotC
     }, vo_opaque);
 }
 
+void MDK_Player_snapshotToFile(mdkPlayer* p, const mdkSnapshotRequest* request, const char* file, const char* format, void* vo_opaque)
+{
+    if (!file)
+        return;
+    Player::SnapshotRequest r;
+    r.width = request ? request->width : 0;
+    r.height = request ? request->height : 0;
+    r.subtitle = request && request->subtitle;
+    p->snapshot(&r, [target = p->raise_target, file = string(file), format = string(format ? format : "")](const Player::SnapshotRequest* req, double){
+        MediaEvent e;
+        e.category = "snapshot";
+        e.detail = file;
+        e.error = -1;
+        if (req && req->buf) { // encode readback data in snapshot thread
+            VideoFrame frame(req->width, req->height, PixelFormat::BGRA);
+            frame.addBuffer(req->buf->constData(), req->stride, nullptr, nullptr, 0);
+            if (frame.save(file.data(), format.empty() ? nullptr : format.data()))
+                e.error = 0;
+        }
+        const lock_guard<mutex> lock(target->mtx);
+        if (target->p)
+            target->p->raise(e);
+        return string();
+    }, vo_opaque);
+}
+
+int MDK_Player_latencyStats(mdkPlayer* p, mdkApiLatency* stats, int count, bool reset)
+{
+    if (!p->latency)
+        return 0;
+    return p->latency->stats(stats, count, reset);
+}
+
 void MDK_Player_setProperty(mdkPlayer* p, const char* key, const char* value)
 {
     p->setProperty(key, value);
@@ -465,6 +1463,10 @@ void MDK_Player_setPointMap(mdkPlayer* p, const float* videoRoi, const float* vi
 
 void MDK_Player_onSync(mdkPlayer* p, mdkSyncCallback cb, int minInterval)
 {
+    if (!cb.cb) {
+        p->onSync(nullptr, minInterval);
+        return;
+    }
     p->onSync([cb]{
         return cb.cb(cb.opaque);
     }, minInterval);
@@ -520,7 +1522,54 @@ int MDK_Player_bufferedTimeRanges(mdkPlayer* p, int64_t* t, int count)
 
 bool MDK_Player_appendBuffer(mdkPlayer* p, const uint8_t* data, size_t size, int options)
 {
-    return p->appendBuffer(data, size, options);
+    if (!p->appendBuffer(data, size, options))
+        return false;
+    p->appended_bytes += size;
+    return true;
+}
+
+bool MDK_Player_appendBufferCopy(mdkPlayer* p, const uint8_t* data, size_t size, void* buf, void (*bufDeleter)(void** pBuf), int options)
+{
+    const auto ok = MDK_Player_appendBuffer(p, data, size, options);
+    if (bufDeleter)
+        bufDeleter(&buf);
+    return ok;
+}
+
+bool MDK_Player_appendBuffers(mdkPlayer* p, const mdkBufferSegment* segments, int count, int options)
+{
+    if (!segments || count < 0)
+        return false;
+    int last = count - 1; // options are for the chunk, only the last non-empty segment has them
+    while (last >= 0 && segments[last].size == 0)
+        --last;
+    for (int i = 0; i <= last; ++i) {
+        if (segments[i].size == 0)
+            continue;
+        if (!MDK_Player_appendBuffer(p, segments[i].data, segments[i].size, i == last ? options : 0))
+            return false; // appended segments are not reverted
+    }
+    return true;
+}
+
+void MDK_Player_bufferLevel(mdkPlayer* p, mdkBufferLevel* level)
+{
+    if (level)
+        p->bufferLevel(level);
+}
+
+void MDK_Player_setBufferWatermarks(mdkPlayer* p, int64_t lowMs, int64_t highMs, int intervalMs, mdkBufferWatermarkCallback cb)
+{
+    unique_ptr<BufferWatermarks> w;
+    if (cb.cb && highMs > lowMs)
+        w = make_unique<BufferWatermarks>(p, lowMs, highMs, intervalMs > 0 ? intervalMs : 50, cb);
+    const lock_guard<mutex> lock(p->watermarks_mtx);
+    p->watermarks.swap(w); // old watcher is stopped out of scope
+}
+
+int MDK_Player_videoFramePoolStats(mdkPlayer* p, int64_t* hits, int64_t* misses)
+{
+    return p->video_frames.stats(hits, misses);
 }
 
 const mdkPlayerAPI* mdkPlayerAPI_new()
@@ -528,7 +1577,19 @@ const mdkPlayerAPI* mdkPlayerAPI_new()
     mdkPlayerAPI* p = new mdkPlayerAPI();
     p->size = sizeof(mdkPlayerAPI);
     p->object = new mdkPlayer();
-#define SET_API(FN) p->FN = MDK_Player_##FN
+    const bool timed = ApiLatency::enabled();
+    if (timed)
+        p->object->latency = make_unique<ApiLatency>();
+// Slot is a constant expression, so a timed function is a distinct instantiation without lookup
+#define SET_API(FN) do { \
+        constexpr int slot = offsetof(mdkPlayerAPI, FN) / sizeof(void*); \
+        if (timed) { \
+            ApiLatency::setName(slot, #FN); \
+            p->FN = Timed<slot, MDK_Player_##FN>::call; \
+        } else { \
+            p->FN = MDK_Player_##FN; \
+        } \
+    } while (false)
     SET_API(setMute);
     SET_API(setVolume);
     SET_API(setChannelVolume);
@@ -596,7 +1657,22 @@ const mdkPlayerAPI* mdkPlayerAPI_new()
     SET_API(enqueueVideo);
     SET_API(bufferedTimeRanges);
     SET_API(appendBuffer);
+    SET_API(videoFramePoolStats);
+    SET_API(mediaInfoChanged);
+    SET_API(mediaInfoSnapshot);
+    SET_API(setEventQueue);
+    SET_API(pollEvents);
+    SET_API(onEventMask);
+    SET_API(appendBufferCopy);
+    SET_API(appendBuffers);
+    SET_API(bufferLevel);
+    SET_API(setBufferWatermarks);
+    SET_API(snapshotToFile);
+    SET_API(latencyStats);
+    SET_API(onVideoRef);
 #undef SET_API
+    watchMediaInfoEvents(p->object);
+    watchMediaInfoStatus(p->object);
     return p;
 }
 
@@ -609,9 +1685,14 @@ void mdkPlayerAPI_delete(const mdkPlayerAPI** pp)
     p->setRenderCallback(nullptr);
     p->onMediaStatus(nullptr);
     p->onStateChanged(nullptr);
-    p->onEvent(nullptr);
+    p->removeListener(nullptr);
     p->onFrame<VideoFrame>(nullptr);
     p->setTimeout(0, nullptr);
+    p->watermarks.reset();
+    {
+        const lock_guard<mutex> lock(p->raise_target->mtx);
+        p->raise_target->p = nullptr;
+    }
     delete p;
     delete *pp;
     *pp = nullptr;
@@ -622,4 +1703,60 @@ void MDK_foreignGLContextDestroyed()
     Player::foreignGLContextDestroyed();
 }
 
+size_t MDK_snapshotBatchArenaSize(const mdkSnapshotBatchEntry* entries, int count)
+{
+    size_t size = 0;
+    for (int i = 0; entries && i < count; ++i) {
+        const auto& r = entries[i].request;
+        if (r.width > 0 && r.height > 0)
+            size += (size_t)snapshot_stride(r.width) * r.height;
+    }
+    return size;
+}
+
+bool MDK_snapshotBatch(const mdkSnapshotBatchEntry* entries, int count, uint8_t* arena, size_t arenaSize, mdkSnapshotBatchCallback cb)
+{
+    if (!entries || count <= 0 || !arena || !cb.cb)
+        return false;
+    for (int i = 0; i < count; ++i) {
+        const auto& e = entries[i];
+        if (!e.player || !e.player->object || e.request.width <= 0 || e.request.height <= 0)
+            return false;
+    }
+    if (arenaSize < MDK_snapshotBatchArenaSize(entries, count))
+        return false;
+    auto b = make_shared<SnapshotBatch>();
+    b->cb = cb;
+    b->results.resize(count);
+    b->files.resize(count);
+    b->pending = count;
+    size_t offset = 0;
+    for (int i = 0; i < count; ++i) {
+        const auto& e = entries[i];
+        auto& q = b->results[i].request;
+        q = e.request;
+        q.stride = snapshot_stride(q.width);
+        q.data = arena + offset;
+        offset += (size_t)q.stride * q.height;
+        if (e.file)
+            b->files[i] = e.file;
+        b->views.emplace_back(q.stride, q.height, q.data);
+    }
+    // all views are created before the first callback
+    for (int i = 0; i < count; ++i) {
+        const auto& q = b->results[i].request;
+        Player::SnapshotRequest r;
+        r.width = q.width;
+        r.height = q.height;
+        r.stride = q.stride;
+        r.subtitle = q.subtitle;
+        r.buf = shared_ptr<Buffer>(b, &b->views[i]);
+        entries[i].player->object->snapshot(&r, [b, i](const Player::SnapshotRequest* req, double frameTime){
+            b->onSnapshot(i, req, frameTime);
+            return string();
+        }, entries[i].vo_opaque);
+    }
+    return true;
+}
+
 } // extern "C"
\ No newline at end of file
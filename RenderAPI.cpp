@@ -16,7 +16,20 @@
 using namespace std;
 using namespace MDK_NS;
 
-unique_ptr<RenderAPI> from_c(MDK_RenderAPI type, void* data)
+// api is reused if update is true and it's not null
+template<class T>
+static T* reuse(unique_ptr<RenderAPI>& api, bool update)
+{
+    if (!update || !api)
+        api = make_unique<T>();
+    return static_cast<T*>(api.get());
+}
+
+/*
+  Convert a C api to out. If update is true, api is of the same type and filled in place, so the object and pointer passed to player
+  is not changed, otherwise a new object is created.
+ */
+RenderAPI* from_c(MDK_RenderAPI type, void* data, unique_ptr<RenderAPI>& out, bool update)
 {
     [[maybe_unused]] const int version = (type >> 16);
     const int struct_sz = ((type << 2) >> 18) & 0xffff;
@@ -26,7 +39,7 @@ unique_ptr<RenderAPI> from_c(MDK_RenderAPI type, void* data)
     switch (type) {
     case MDK_RenderAPI_OpenGL: {
         auto c = static_cast<mdkGLRenderAPI*>(data);
-        auto api = make_unique<GLRenderAPI>();
+        auto api = reuse<GLRenderAPI>(out, update);
         api->fbo = c->fbo;
         api->getProcAddress = c->getProcAddress;
         api->getCurrentNativeContext = c->getCurrentNativeContext;
@@ -41,7 +54,7 @@ unique_ptr<RenderAPI> from_c(MDK_RenderAPI type, void* data)
     }
     case MDK_RenderAPI_Metal: {
         auto c = static_cast<mdkMetalRenderAPI*>(data);
-        auto api = make_unique<MetalRenderAPI>();
+        auto api = reuse<MetalRenderAPI>(out, update);
         api->device = c->device;
         api->cmdQueue = c->cmdQueue;
         api->texture = c->texture;
@@ -59,7 +72,9 @@ unique_ptr<RenderAPI> from_c(MDK_RenderAPI type, void* data)
 #if defined(D3D11_SDK_VERSION)
     case MDK_RenderAPI_D3D11: {
         auto c = static_cast<mdkD3D11RenderAPI*>(data);
-        auto api = make_unique<D3D11RenderAPI>(c->context, c->rtv);
+        auto api = reuse<D3D11RenderAPI>(out, update);
+        api->context = c->context;
+        api->rtv = c->rtv;
         api->debug = c->debug;
         api->buffers = c->buffers;
         api->adapter = c->adapter;
@@ -73,7 +88,9 @@ unique_ptr<RenderAPI> from_c(MDK_RenderAPI type, void* data)
 #if defined(__d3d12_h__)
     case MDK_RenderAPI_D3D12: {
         auto c = static_cast<mdkD3D12RenderAPI*>(data);
-        auto api = make_unique<D3D12RenderAPI>(c->cmdQueue, c->rt);
+        auto api = reuse<D3D12RenderAPI>(out, update);
+        api->cmdQueue = c->cmdQueue;
+        api->rt = c->rt;
         api->rtvHandle = c->rtvHandle;
         api->opaque = c->opaque;
         api->currentRenderTarget = c->currentRenderTarget;
@@ -93,7 +110,7 @@ unique_ptr<RenderAPI> from_c(MDK_RenderAPI type, void* data)
 #if (VK_VERSION_1_0+0)
     case MDK_RenderAPI_Vulkan: {
         auto c = static_cast<mdkVulkanRenderAPI*>(data);
-        auto api = make_unique<VulkanRenderAPI>();
+        auto api = reuse<VulkanRenderAPI>(out, update);
         api->instance = c->instance;
         api->phy_device = c->phy_device;
         api->device = c->device;
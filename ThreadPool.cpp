@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(int threads)
+{
+    threads_.reserve(threads);
+    for (int i = 0; i < threads; ++i)
+        threads_.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        const lock_guard<mutex> lock(mtx_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_)
+        t.join();
+}
+
+void ThreadPool::run(function<void()>&& task)
+{
+    {
+        const lock_guard<mutex> lock(mtx_);
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::parallelFor(int count, const function<void(int)>& f)
+{
+    if (count <= 0)
+        return;
+    // pool tasks may start after all indices are done by other threads, so state is shared
+    struct State {
+        atomic<int> next = 0;
+        int done = 0;
+        mutex mtx;
+        condition_variable cv;
+    };
+    const auto s = make_shared<State>();
+    // f is alive until all indices are done, and a late task does not call it
+    const auto work = [s, count, &f] {
+        int n = 0;
+        for (int i = s->next++; i < count; i = s->next++) {
+            f(i);
+            ++n;
+        }
+        if (n == 0)
+            return;
+        const lock_guard<mutex> lock(s->mtx);
+        s->done += n;
+        if (s->done == count)
+            s->cv.notify_all();
+    };
+    const int helpers = count - 1 < threads() ? count - 1 : threads();
+    for (int i = 0; i < helpers; ++i)
+        run(work);
+    work();
+    unique_lock<mutex> lock(s->mtx);
+    s->cv.wait(lock, [&]{ return s->done == count; });
+}
+
+void ThreadPool::work()
+{
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(mtx_);
+            cv_.wait(lock, [this]{ return quit_ || !tasks_.empty(); });
+            if (tasks_.empty())
+                return;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
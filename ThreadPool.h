@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+  A fixed size thread pool. Queued tasks are finished before destroyed.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    int threads() const { return (int)threads_.size(); }
+    void run(function<void()>&& task);
+    // call f(i) for i in [0, count) in pool threads and the calling thread, return when all are done. can be called concurrently
+    void parallelFor(int count, const function<void(int)>& f);
+private:
+    void work();
+
+    mutex mtx_;
+    condition_variable cv_;
+    deque<function<void()>> tasks_;
+    bool quit_ = false;
+    vector<thread> threads_;
+};
@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#include "mdk/c/Thumbnail.h"
+#include "mdk/Player.h"
+#include "mdk/VideoFrame.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace MDK_NS;
+
+extern PixelFormat fromC(MDK_PixelFormat fmt);
+extern bool MDK_VideoFrame_toBuffersC(const VideoFrame& src, PixelFormat fmt, int width, int height, uint8_t* const* data, int* strides);
+
+// extra time to wait for load or seek callback after player timeout
+static constexpr int64_t kTimeoutGrace = 1000;
+static constexpr int64_t kDefaultTimeout = 10000; // the same as Player
+// max frames decoded forward from the previous exact thumbnail instead of a seek from key frame, about a GOP
+static constexpr int kForwardFrames = 60;
+
+// max rows of a sheet if not set, so that a sheet buffer is bounded by tile size
+static constexpr int kDefaultRows = 10;
+
+static int option_int(const char* key, int defaultValue)
+{
+    if (const auto v = get_if<int>(&GetGlobalOption(key)))
+        return *v;
+    return defaultValue;
+}
+
+/*
+  A load or seek is a step. Results of the current step are set by player callbacks, and callbacks of old steps are ignored.
+  Frames of old steps can still be delivered after a new seek, so a frame is accepted only if it is not older than the seek result.
+ */
+struct mdkThumbnailer {
+    Player player;
+    mutex mtx;
+    condition_variable cv;
+    uint64_t step = 0;
+    bool want_frame = false; // keep the first frame delivered in current step
+    bool done = false; // load or seek callback is called
+    int64_t result = 0; // position in load or seek callback, <0 if error
+    bool frame_ready = false;
+    VideoFrame frame; // invalid if eos
+    bool has_pending = false;
+    VideoFrame pending; // the latest frame delivered before seek callback, checked in finish()
+    atomic<bool> canceled = false;
+
+    mdkThumbnailer() {
+        player.setActiveTracks(MediaType::Audio, {});
+        player.setActiveTracks(MediaType::Subtitle, {});
+        player.setProperty("continue_at_end", "1"); // keep decoder alive when seeking near the end
+        player.onFrame<VideoFrame>([this](VideoFrame& f, int) {
+            const lock_guard<mutex> lock(mtx);
+            if (!want_frame || frame_ready)
+                return 0;
+            if (!done) { // can be from an old seek, or the 1st frame of this seek if delivered before seek callback
+                pending = f;
+                has_pending = true;
+                return 0;
+            }
+            accept(f);
+            return 0;
+        });
+    }
+
+    ~mdkThumbnailer() {
+        player.onFrame<VideoFrame>(nullptr);
+        player.setTimeout(0, nullptr);
+    }
+
+    // in lock, after seek callback of current step
+    void accept(VideoFrame& f) {
+        if (result < 0)
+            return;
+        if (f.timestamp() != TimestampEOS) {
+            if (f.timestamp() * 1000.0 < double(result - 1)) // decoded before seek
+                return;
+            frame = std::move(f);
+        }
+        frame_ready = true;
+        cv.notify_all();
+    }
+
+    uint64_t begin(bool wantFrame) {
+        const lock_guard<mutex> lock(mtx);
+        want_frame = wantFrame;
+        done = false;
+        result = 0;
+        frame_ready = false;
+        frame = VideoFrame();
+        has_pending = false;
+        pending = VideoFrame();
+        return ++step;
+    }
+
+    void finish(uint64_t s, int64_t position) {
+        const lock_guard<mutex> lock(mtx);
+        if (s != step)
+            return;
+        done = true;
+        result = position;
+        if (want_frame && has_pending) {
+            has_pending = false;
+            accept(pending);
+        }
+        cv.notify_all();
+    }
+
+    // 0 or error of current step
+    int wait(int64_t timeout) {
+        unique_lock<mutex> lock(mtx);
+        const auto ready = [this]{ return done && (result < 0 || !want_frame || frame_ready); };
+        cv.wait_for(lock, chrono::milliseconds(timeout), [&]{ return canceled || ready(); });
+        if (!ready())
+            return canceled ? MDK_Thumbnail_Canceled : MDK_Thumbnail_Timeout;
+        if (result < 0)
+            return result < INT_MIN ? INT_MIN : int(result);
+        if (want_frame && !frame)
+            return MDK_Thumbnail_NoFrame;
+        return 0;
+    }
+
+    VideoFrame takeFrame() {
+        const lock_guard<mutex> lock(mtx);
+        return std::move(frame);
+    }
+
+    int seek(int64_t pos, SeekFlag flags, int64_t timeout) {
+        const auto s = begin(true);
+        if (!player.seek(pos, flags, [this, s](int64_t value){ finish(s, value); }))
+            return MDK_Thumbnail_NoFrame;
+        return wait(timeout);
+    }
+};
+
+static int bytes_per_pixel(PixelFormat fmt)
+{
+    switch (fmt) {
+    case PixelFormat::RGBA:
+    case PixelFormat::RGBX:
+    case PixelFormat::BGRA:
+    case PixelFormat::BGRX:
+        return 4;
+    case PixelFormat::RGB24:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+static string sheet_file(const char* pattern, int index, bool multiple)
+{
+    string f(pattern);
+    if (const auto pos = f.find("%d"); pos != string::npos)
+        return f.replace(pos, 2, to_string(index));
+    if (!multiple)
+        return f;
+    const auto dot = f.rfind('.');
+    const auto slash = f.find_last_of("/\\");
+    const auto pos = dot != string::npos && (slash == string::npos || dot > slash) ? dot : f.size();
+    return f.insert(pos, "-" + to_string(index));
+}
+
+static string vtt_time(int64_t ms)
+{
+    if (ms < 0)
+        ms = 0;
+    char t[32];
+    snprintf(t, sizeof(t), "%02d:%02d:%02d.%03d", int(ms / 3600000), int(ms / 60000 % 60), int(ms / 1000 % 60), int(ms % 1000));
+    return t;
+}
+
+/*
+  Tiles of all sheets are written into the same sheet buffer. Tiles are reported in tile order because timestamps are sorted,
+  so a sheet is encoded and cleared once its last tile is reported.
+ */
+struct SpriteSheetWriter {
+    const mdkSpriteSheetRequest* req = nullptr;
+    mdkThumbnailCallback cb{};
+    vector<int64_t> timestamps; // sorted
+    int columns = 0;
+    int per_sheet = 0;
+    int sheets = 0;
+    int stride = 0;
+    size_t size = 0;
+    unique_ptr<uint8_t, decltype(&free)> data{nullptr, &free};
+    vector<uint8_t*> tiles;
+    int reported = 0;
+    int written = 0;
+    bool encode_error = false;
+
+    bool flush() {
+        const int n = reported - written * per_sheet;
+        if (n <= 0)
+            return true;
+        const auto& t = req->thumbnail;
+        VideoFrame sheet(columns * t.width, (n + columns - 1) / columns * t.height, PixelFormat::RGBA);
+        sheet.addBuffer(data.get(), stride, nullptr, nullptr, 0);
+        if (!sheet.save(sheet_file(req->file, written, sheets > 1).c_str(), nullptr, req->quality)) {
+            encode_error = true;
+            return false;
+        }
+        ++written;
+        memset(data.get(), 0, size);
+        return true;
+    }
+
+    bool writeVtt() const {
+        ofstream vtt(req->vttFile, ios::binary);
+        if (!vtt)
+            return false;
+        vtt << "WEBVTT\n";
+        const auto& t = req->thumbnail;
+        const int tiles = std::min(reported, written * per_sheet);
+        for (int i = 0; i < tiles; ++i) {
+            const int64_t start = timestamps[i];
+            int64_t end = start + 1000;
+            if (i + 1 < (int)timestamps.size())
+                end = timestamps[i + 1];
+            else if (!t.timestamps && t.interval > 0)
+                end = start + t.interval;
+            else if (i > 0)
+                end = start + start - timestamps[i - 1];
+            auto name = sheet_file(req->file, i / per_sheet, sheets > 1);
+            if (const auto slash = name.find_last_of("/\\"); slash != string::npos)
+                name.erase(0, slash + 1);
+            const int pos = i % per_sheet;
+            vtt << "\n" << vtt_time(start) << " --> " << vtt_time(end) << "\n"
+                << name << "#xywh=" << pos % columns * t.width << "," << pos / columns * t.height << "," << t.width << "," << t.height << "\n";
+        }
+        return (bool)vtt;
+    }
+
+    static bool onTile(int index, int64_t timestamp, int64_t frameTime, int error, void* opaque) {
+        auto w = static_cast<SpriteSheetWriter*>(opaque);
+        w->reported = index + 1;
+        const bool next = !w->cb.cb || w->cb.cb(index, timestamp, frameTime, error, w->cb.opaque);
+        if (w->reported % w->per_sheet == 0 || w->reported == (int)w->timestamps.size()) {
+            if (!w->flush())
+                return false;
+        }
+        return next;
+    }
+};
+
+extern "C" {
+
+mdkThumbnailer* MDK_Thumbnailer_new()
+{
+    return new mdkThumbnailer();
+}
+
+void MDK_Thumbnailer_delete(mdkThumbnailer** pp)
+{
+    if (!pp || !*pp)
+        return;
+    delete *pp;
+    *pp = nullptr;
+}
+
+int MDK_Thumbnailer_generate(mdkThumbnailer* t, const mdkThumbnailRequest* req, mdkThumbnailCallback cb)
+{
+    if (!req || !req->url || req->count <= 0 || req->width <= 0 || req->height <= 0 || !req->data || !cb.cb)
+        return MDK_Thumbnail_InvalidArgument;
+    const auto fmt = req->format == MDK_PixelFormat_Unknown ? PixelFormat::RGBA : fromC(req->format);
+    const int bpp = bytes_per_pixel(fmt);
+    if (bpp == 0) // not a supported output format
+        return MDK_Thumbnail_InvalidArgument;
+    const int stride = req->stride > 0 ? req->stride : req->width * bpp;
+    // one forward pass
+    vector<pair<int64_t, int>> items(req->count);
+    for (int i = 0; i < req->count; ++i)
+        items[i] = {req->timestamps ? req->timestamps[i] : req->start + i * req->interval, i};
+    stable_sort(items.begin(), items.end());
+
+    const auto timeout = req->timeout > 0 ? req->timeout : kDefaultTimeout;
+    auto& player = t->player;
+    t->canceled = false;
+    player.setTimeout(timeout, [](int64_t){ return true; }); // abort loading
+    player.setMedia(req->url);
+    auto s = t->begin(false);
+    player.prepare(0, [t, s](int64_t position, bool*){
+        t->finish(s, position);
+        return true;
+    });
+    if (const int error = t->wait(timeout + kTimeoutGrace)) {
+        t->begin(false);
+        player.set(State::Stopped);
+        player.waitFor(State::Stopped);
+        return error;
+    }
+
+    const auto flags = req->exact ? SeekFlag::FromStart : SeekFlag::FromStart | SeekFlag::KeyFrame;
+    // key frames are unknown, so nearby timestamps decode forward from the previous frame if no more than forward_frames.
+    // it's at most forward_frames decoded frames more than a seek if a key frame is between them
+    const int forward_frames = req->exact ? option_int("thumbnail.forward_frames", kForwardFrames) : 0;
+    const auto& info = player.mediaInfo();
+    const double frame_ms = !info.video.empty() && info.video[0].codec.frame_rate > 0 ? 1000.0 / info.video[0].codec.frame_rate : 0;
+    const auto frame_pos = [&info](const VideoFrame& f) { return f.timestamp() * 1000.0 - double(info.start_time); };
+    VideoFrame last; // decoder position if exact
+    int written = 0;
+    for (const auto& [timestamp, index] : items) {
+        int error = MDK_Thumbnail_Canceled;
+        int64_t frame_time = 0;
+        VideoFrame frame;
+        if (!t->canceled && last && frame_ms > 0) {
+            // the 1st frame >= timestamp
+            const auto steps = (int64_t)ceil((double(timestamp) - frame_pos(last)) / frame_ms - 0.01);
+            if (steps <= 0) {
+                frame = last;
+                error = 0;
+            } else if (steps <= forward_frames) {
+                error = t->seek(steps, SeekFlag::FromNow | SeekFlag::Frame, timeout + kTimeoutGrace);
+                if (error == 0) {
+                    frame = t->takeFrame();
+                    const auto pos = frame_pos(frame);
+                    if (pos < double(timestamp - 1) || pos >= double(timestamp) + frame_ms + 1) { // variable frame rate etc.
+                        frame = VideoFrame();
+                        error = MDK_Thumbnail_NoFrame;
+                    }
+                }
+            }
+        }
+        if (!frame && !t->canceled) {
+            error = t->seek(timestamp, flags, timeout + kTimeoutGrace);
+            // forward key frame seek fails near the end if no key frame after timestamp
+            if (error == MDK_Thumbnail_NoFrame && !req->exact && !t->canceled)
+                error = t->seek(timestamp, flags | SeekFlag::Backward, timeout + kTimeoutGrace);
+            if (error == 0)
+                frame = t->takeFrame();
+        }
+        if (error == 0) {
+            if (req->exact)
+                last = frame;
+            frame_time = int64_t(frame.timestamp() * 1000.0);
+            int strides[] = {stride, 0, 0, 0};
+            if (MDK_VideoFrame_toBuffersC(frame, fmt, req->width, req->height, &req->data[index], strides))
+                ++written;
+            else
+                error = MDK_Thumbnail_ConvertError;
+        } else if (t->canceled) {
+            error = MDK_Thumbnail_Canceled;
+        }
+        if (!cb.cb(index, timestamp, frame_time, error, cb.opaque))
+            break;
+    }
+    t->begin(false); // ignore late callbacks
+    player.set(State::Stopped);
+    player.waitFor(State::Stopped);
+    return written;
+}
+
+int MDK_Thumbnailer_generateSpriteSheet(mdkThumbnailer* t, const mdkSpriteSheetRequest* req, mdkThumbnailCallback cb)
+{
+    if (!req || !req->file || !req->thumbnail.url || req->thumbnail.count <= 0 || req->thumbnail.width <= 0 || req->thumbnail.height <= 0)
+        return MDK_Thumbnail_InvalidArgument;
+    const auto& r = req->thumbnail;
+    SpriteSheetWriter w;
+    w.req = req;
+    w.cb = cb;
+    w.timestamps.resize(r.count);
+    for (int i = 0; i < r.count; ++i)
+        w.timestamps[i] = r.timestamps ? r.timestamps[i] : r.start + i * r.interval;
+    sort(w.timestamps.begin(), w.timestamps.end());
+    w.columns = std::min(req->columns > 0 ? req->columns : 10, r.count);
+    const int total_rows = (r.count + w.columns - 1) / w.columns;
+    const int rows = std::min(req->rows > 0 ? req->rows : kDefaultRows, total_rows);
+    w.per_sheet = w.columns * rows;
+    w.sheets = (r.count + w.per_sheet - 1) / w.per_sheet;
+    w.stride = w.columns * r.width * 4;
+    w.size = (size_t)w.stride * rows * r.height;
+    w.data.reset((uint8_t*)calloc(w.size, 1));
+    if (!w.data)
+        return MDK_Thumbnail_EncodeError;
+    w.tiles.resize(r.count);
+    for (int i = 0; i < r.count; ++i) {
+        const int pos = i % w.per_sheet;
+        w.tiles[i] = w.data.get() + (size_t)(pos / w.columns) * r.height * w.stride + (size_t)(pos % w.columns) * r.width * 4;
+    }
+
+    auto tr = r;
+    tr.timestamps = w.timestamps.data();
+    tr.format = MDK_PixelFormat_RGBA;
+    tr.data = w.tiles.data();
+    tr.stride = w.stride;
+    const int ret = MDK_Thumbnailer_generate(t, &tr, {&SpriteSheetWriter::onTile, &w});
+    if (ret < 0)
+        return ret;
+    if (!w.encode_error) // stopped in a sheet
+        w.flush();
+    if (req->vttFile && !w.writeVtt())
+        return MDK_Thumbnail_EncodeError;
+    if (w.encode_error)
+        return MDK_Thumbnail_EncodeError;
+    return w.written;
+}
+
+void MDK_Thumbnailer_cancel(mdkThumbnailer* t)
+{
+    t->canceled = true;
+    const lock_guard<mutex> lock(t->mtx);
+    t->cv.notify_all();
+}
+
+} // extern "C"
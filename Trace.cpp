@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+struct TraceEvent {
+    const char* cat;
+    const char* name;
+    const void* player;
+    uint64_t id; // async span
+    int64_t ts;
+    int64_t dur;
+    int64_t value;
+    uint32_t session; // events of a stopped trace are dropped
+    char phase;
+    char detail[64];
+};
+
+struct TraceChunk {
+    static constexpr int kSize = 256;
+    TraceEvent events[kSize];
+    atomic<int> count = 0; // published events
+    atomic<TraceChunk*> next = nullptr; // set after chunk is full
+};
+
+/*
+  Events of a thread, single producer(the thread) and single consumer(the writer). Written chunks are released by consumer.
+ */
+struct TraceBuffer {
+    int tid;
+    TraceChunk* head; // consumer
+    int read = 0; // consumer position in head
+    TraceChunk* tail; // producer
+    atomic<bool> exited = false; // no more events
+
+    explicit TraceBuffer(int id) : tid(id) {
+        head = tail = new TraceChunk();
+    }
+
+    ~TraceBuffer() {
+        while (head) {
+            delete exchange(head, head->next.load());
+        }
+    }
+
+    void push(const TraceEvent& e) {
+        const int n = tail->count.load(memory_order_relaxed);
+        if (n < TraceChunk::kSize) {
+            tail->events[n] = e;
+            tail->count.store(n + 1, memory_order_release);
+            return;
+        }
+        auto c = new TraceChunk();
+        c->events[0] = e;
+        c->count.store(1, memory_order_relaxed);
+        tail->next.store(c, memory_order_release);
+        tail = c;
+    }
+
+    // return false if all events of an exited thread are consumed
+    template<typename F>
+    bool consume(F&& f) {
+        const bool done = exited.load(memory_order_acquire);
+        while (true) {
+            const auto next = head->next.load(memory_order_acquire); // count is kSize if next is not null
+            const int n = head->count.load(memory_order_acquire);
+            for (; read < n; ++read)
+                f(head->events[read]);
+            if (!next)
+                return !done;
+            delete exchange(head, next);
+            read = 0;
+        }
+    }
+};
+
+class TraceRecorder {
+public:
+    static TraceRecorder& instance() {
+        static TraceRecorder r;
+        return r;
+    }
+
+    ~TraceRecorder() {
+        stop();
+        // buffers of alive threads are leaked, threads may write after exit()
+    }
+
+    bool start(const char* file) {
+        stop();
+        if (!file || !*file)
+            return true;
+        const lock_guard<mutex> lock(file_mtx_);
+        file_ = fopen(file, "wb");
+        if (!file_)
+            return false;
+        fputs("{\"traceEvents\":[\n", file_);
+        first_ = true;
+        quit_ = false;
+        ++session_;
+        enabled_.store(true, memory_order_release);
+        thread_ = thread(&TraceRecorder::run, this);
+        return true;
+    }
+
+    void stop() {
+        const lock_guard<mutex> lock(file_mtx_);
+        if (!file_)
+            return;
+        enabled_.store(false, memory_order_release);
+        {
+            const lock_guard<mutex> lock2(mtx_);
+            quit_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+        drain();
+        fputs("\n]}\n", file_);
+        fclose(file_);
+        file_ = nullptr;
+    }
+
+    bool enabled() const { return enabled_.load(memory_order_acquire); }
+
+    int64_t now() const {
+        return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0_).count();
+    }
+
+    void add(char phase, const char* cat, const char* name, const void* player, uint64_t id, int64_t ts, int64_t dur, int64_t value, const char* detail) {
+        TraceEvent e;
+        e.cat = cat;
+        e.name = name;
+        e.player = player;
+        e.id = id;
+        e.ts = ts;
+        e.dur = dur;
+        e.value = value;
+        e.session = session_.load(memory_order_relaxed);
+        e.phase = phase;
+        e.detail[0] = 0;
+        if (detail) {
+            strncpy(e.detail, detail, sizeof(e.detail) - 1);
+            e.detail[sizeof(e.detail) - 1] = 0;
+        }
+        local()->push(e);
+    }
+private:
+    struct Local {
+        TraceBuffer* buffer = nullptr;
+        ~Local() {
+            if (buffer)
+                buffer->exited.store(true, memory_order_release);
+        }
+    };
+
+    TraceBuffer* local() {
+        thread_local Local t;
+        if (!t.buffer) {
+            const lock_guard<mutex> lock(mtx_);
+            t.buffer = new TraceBuffer(++tids_);
+            buffers_.push_back(t.buffer);
+        }
+        return t.buffer;
+    }
+
+    void run() {
+        unique_lock<mutex> lock(mtx_);
+        while (!quit_) {
+            cv_.wait_for(lock, chrono::milliseconds(kFlushInterval), [this]{ return quit_; });
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
+
+    // writer thread, or after writer thread is finished
+    void drain() {
+        vector<TraceBuffer*> buffers;
+        {
+            const lock_guard<mutex> lock(mtx_);
+            buffers = buffers_;
+        }
+        const auto session = session_.load(memory_order_relaxed);
+        for (auto b : buffers) {
+            const bool alive = b->consume([&](const TraceEvent& e) {
+                if (e.session == session)
+                    write(b->tid, e);
+            });
+            if (alive)
+                continue;
+            {
+                const lock_guard<mutex> lock(mtx_);
+                buffers_.erase(find(buffers_.begin(), buffers_.end(), b));
+            }
+            delete b;
+        }
+        fflush(file_);
+    }
+
+    void write(int tid, const TraceEvent& e) {
+        char detail[2 * sizeof(e.detail)];
+        size_t n = 0;
+        for (const char* s = e.detail; *s; ++s) {
+            if (*s == '"' || *s == '\\')
+                detail[n++] = '\\';
+            detail[n++] = (unsigned char)*s < 0x20 ? ' ' : *s;
+        }
+        detail[n] = 0;
+        fprintf(file_, "%s{\"cat\":\"%s\",\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":%d",
+                first_ ? "" : ",\n", e.cat, e.name, e.phase, (long long)e.ts, tid);
+        first_ = false;
+        if (e.phase == 'X')
+            fprintf(file_, ",\"dur\":%lld", (long long)e.dur);
+        else if (e.phase == 'i')
+            fputs(",\"s\":\"t\"", file_);
+        else
+            fprintf(file_, ",\"id\":\"0x%llx\"", (unsigned long long)e.id);
+        fprintf(file_, ",\"args\":{\"player\":\"%p\",\"value\":%lld", e.player, (long long)e.value);
+        if (n > 0)
+            fprintf(file_, ",\"detail\":\"%s\"", detail);
+        fputs("}}", file_);
+    }
+
+    static constexpr int kFlushInterval = 500; // ms
+
+    atomic<bool> enabled_ = false;
+    atomic<uint32_t> session_ = 0;
+    const chrono::steady_clock::time_point t0_ = chrono::steady_clock::now(); // the same for all traces
+    mutex file_mtx_; // start() and stop()
+    FILE* file_ = nullptr;
+    bool first_ = true;
+    mutex mtx_; // buffers_ and quit_
+    condition_variable cv_;
+    vector<TraceBuffer*> buffers_;
+    int tids_ = 0;
+    bool quit_ = false;
+    thread thread_;
+};
+
+bool TraceStart(const char* file)
+{
+    return TraceRecorder::instance().start(file);
+}
+
+void TraceStop()
+{
+    TraceRecorder::instance().stop();
+}
+
+bool TraceEnabled()
+{
+    return TraceRecorder::instance().enabled();
+}
+
+int64_t TraceNow()
+{
+    return TraceRecorder::instance().now();
+}
+
+void TraceInstant(const char* cat, const char* name, const void* player, int64_t value, const char* detail)
+{
+    auto& r = TraceRecorder::instance();
+    if (r.enabled())
+        r.add('i', cat, name, player, 0, r.now(), 0, value, detail);
+}
+
+uint64_t TraceNewId()
+{
+    static atomic<uint64_t> id = 0;
+    return ++id;
+}
+
+void TraceAsyncBegin(const char* cat, const char* name, const void* player, uint64_t id, int64_t value)
+{
+    auto& r = TraceRecorder::instance();
+    if (r.enabled())
+        r.add('b', cat, name, player, id, r.now(), 0, value, nullptr);
+}
+
+void TraceAsyncEnd(const char* cat, const char* name, const void* player, uint64_t id, int64_t value)
+{
+    auto& r = TraceRecorder::instance();
+    if (r.enabled())
+        r.add('e', cat, name, player, id, r.now(), 0, value, nullptr);
+}
+
+void TraceComplete(const char* cat, const char* name, const void* player, int64_t start, int64_t value)
+{
+    auto& r = TraceRecorder::instance();
+    if (r.enabled()) {
+        const auto t = r.now();
+        r.add('X', cat, name, player, 0, start, t - start, value, nullptr);
+    }
+}
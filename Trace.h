@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+#pragma once
+#include <cstdint>
+
+/*
+  Chrome trace event(JSON) recorder, enabled by global option "trace.file". Open the file in chrome://tracing or ui.perfetto.dev.
+  Events are appended to per-thread buffers without lock, and written to the file in a writer thread.
+  cat and name MUST be string literals, detail is copied. player is an arg of events.
+ */
+// null or empty file: stop and finish the file
+bool TraceStart(const char* file);
+void TraceStop();
+bool TraceEnabled();
+// microseconds since trace start
+int64_t TraceNow();
+void TraceInstant(const char* cat, const char* name, const void* player, int64_t value = 0, const char* detail = nullptr);
+// unique id of an async span
+uint64_t TraceNewId();
+// async events of the same cat, name and id are a span, e.g. prepare() and prepare callback. overlapping calls MUST use different ids
+void TraceAsyncBegin(const char* cat, const char* name, const void* player, uint64_t id, int64_t value = 0);
+void TraceAsyncEnd(const char* cat, const char* name, const void* player, uint64_t id, int64_t value = 0);
+// a span from start to now in the current thread
+void TraceComplete(const char* cat, const char* name, const void* player, int64_t start, int64_t value = 0);
@@ -3,8 +3,10 @@
  */
 #include "mdk/c/VideoFrame.h"
 #include "mdk/VideoFrame.h"
+#include "PixelConvert.h"
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 
 using namespace std;
 using namespace MDK_NS;
@@ -84,6 +86,8 @@ MDK_PixelFormat toC(PixelFormat fmt)
 }
 
 mdkVideoFrameAPI* MDK_VideoFrame_toC(const VideoFrame& frame);
+mdkVideoFrameRef MDK_VideoFrame_toRefC(const VideoFrame& frame);
+bool MDK_VideoFrame_toBuffersC(const VideoFrame& src, PixelFormat fmt, int width, int height, uint8_t* const* data, int* strides);
 
 extern "C" {
 static void init_mdkVideoFrameAPI(mdkVideoFrameAPI* p);
@@ -140,7 +144,23 @@ double MDK_VideoFrame_timestamp(mdkVideoFrame* p)
 
 mdkVideoFrameAPI* MDK_VideoFrame_to(mdkVideoFrame* p, MDK_PixelFormat format, int width/*= -1*/, int height/*= -1*/)
 {
-    return MDK_VideoFrame_toC(p->frame.to(fromC(format), width, height));
+    const auto fmt = fromC(format);
+    if (auto frame = PixelConvert(p->frame, fmt, width, height)) // simd fast path of common host memory formats
+        return MDK_VideoFrame_toC(frame);
+    return MDK_VideoFrame_toC(p->frame.to(fmt, width, height));
+}
+
+mdkVideoFrameRef MDK_VideoFrame_toRef(mdkVideoFrame* p, MDK_PixelFormat format, int width/*= -1*/, int height/*= -1*/)
+{
+    const auto fmt = fromC(format);
+    if (auto frame = PixelConvert(p->frame, fmt, width, height))
+        return MDK_VideoFrame_toRefC(frame);
+    return MDK_VideoFrame_toRefC(p->frame.to(fmt, width, height));
+}
+
+bool MDK_VideoFrame_toBuffers(mdkVideoFrame* p, MDK_PixelFormat format, int width, int height, uint8_t* const* data, int* strides)
+{
+    return MDK_VideoFrame_toBuffersC(p->frame, fromC(format), width, height, data, strides);
 }
 
 bool MDK_VideoFrame_save(mdkVideoFrame* p, const char* fileName, const char* format, float quality)
@@ -191,13 +211,16 @@ bool MDK_VideoFrame_fromDX9(mdkVideoFrame* p, mdkVideoBufferPool** pool, const m
 }
 #endif // _WIN32
 
-void init_mdkVideoFrameAPI(mdkVideoFrameAPI* p)
+static constexpr mdkVideoFrameAPI make_mdkVideoFrameAPI()
 {
+    mdkVideoFrameAPI api{};
+    auto p = &api;
 #define SET_API(FN) p->FN = MDK_VideoFrame_##FN
     SET_API(planeCount);
     SET_API(width);
     SET_API(height);
     SET_API(format);
+    SET_API(addBuffer);
     SET_API(setBuffers);
     SET_API(bufferData);
     SET_API(bytesPerLine);
@@ -205,11 +228,30 @@ void init_mdkVideoFrameAPI(mdkVideoFrameAPI* p)
     SET_API(timestamp);
     SET_API(to);
     SET_API(save);
+    SET_API(toBuffers);
+    SET_API(toRef);
 #if (_WIN32 + 0)
     SET_API(fromDX11);
     SET_API(fromDX9);
 #endif // _WIN32
 #undef SET_API
+    return api;
+}
+
+// shared by all frames, object is null
+static constexpr mdkVideoFrameAPI kVideoFrameAPI = make_mdkVideoFrameAPI();
+
+// once per mdkVideoFrameAPI allocation, the compatible layout. mdkVideoFrameRef points to kVideoFrameAPI and nothing is written
+void init_mdkVideoFrameAPI(mdkVideoFrameAPI* p)
+{
+    auto obj = p->object;
+    *p = kVideoFrameAPI;
+    p->object = obj;
+}
+
+const mdkVideoFrameAPI* mdkVideoFrameAPI_table()
+{
+    return &kVideoFrameAPI;
 }
 
 mdkVideoFrameAPI* mdkVideoFrameAPI_new(int width/*=0*/, int height/*=0*/, MDK_PixelFormat format/*=Unknown*/)
@@ -230,6 +272,23 @@ void mdkVideoFrameAPI_delete(mdkVideoFrameAPI** pp)
     *pp = nullptr;
 }
 
+mdkVideoFrameRef mdkVideoFrameRef_new(int width/*=0*/, int height/*=0*/, MDK_PixelFormat format/*=Unknown*/)
+{
+    mdkVideoFrameRef ref;
+    ref.api = &kVideoFrameAPI;
+    ref.object = new mdkVideoFrame();
+    ref.object->frame = VideoFrame(width, height, fromC(format));
+    return ref;
+}
+
+void mdkVideoFrameRef_delete(mdkVideoFrameRef* ref)
+{
+    if (!ref)
+        return;
+    delete ref->object;
+    ref->object = nullptr;
+}
+
 void mdkVideoBufferPoolFree(mdkVideoBufferPool** pool)
 {
     if (!pool || !*pool)
@@ -252,9 +311,92 @@ mdkVideoFrameAPI* MDK_VideoFrame_toC(const VideoFrame& frame)
     return api;
 }
 
+mdkVideoFrameRef MDK_VideoFrame_toRefC(const VideoFrame& frame)
+{
+    mdkVideoFrameRef ref{&kVideoFrameAPI, nullptr};
+    if (!frame && frame.timestamp() != TimestampEOS)
+        return ref;
+    ref.object = new mdkVideoFrame();
+    ref.object->frame = frame;
+    return ref;
+}
+
+/*
+  Call cb with a ref of frame on stack, no allocation and table write. The object is only valid in cb.
+  If cb replaces ref.object with a new object, e.g. from mdkVideoFrameRef_new() or toRef(), frame is replaced and the new object is released.
+  Null object drops the frame.
+ */
+int MDK_VideoFrame_withRef(VideoFrame& frame, int (*cb)(mdkVideoFrameRef*, int, void*), int track, void* opaque)
+{
+    mdkVideoFrame obj{frame};
+    mdkVideoFrameRef ref{&kVideoFrameAPI, &obj};
+    if (!frame && frame.timestamp() != TimestampEOS) // the same as MDK_VideoFrame_toC
+        ref.object = nullptr;
+    const auto object = ref.object;
+    const int ret = cb(&ref, track, opaque);
+    if (ref.object == object)
+        return ret;
+    if (!ref.object) {
+        frame = VideoFrame();
+        return ret;
+    }
+    frame = std::move(ref.object->frame);
+    delete ref.object;
+    return ret;
+}
+
+void MDK_VideoFrame_setC(mdkVideoFrameAPI* p, const VideoFrame& frame)
+{
+    p->object->frame = frame;
+}
+
 VideoFrame MDK_VideoFrame_fromC(mdkVideoFrameAPI* p)
 {
     if (!p)
         return {};
     return p->object->frame;
 }
+
+bool MDK_VideoFrame_toBuffersC(const VideoFrame& src, PixelFormat fmt, int width, int height, uint8_t* const* data, int* strides)
+{
+    if (!data)
+        return false;
+    if (PixelConvertSupported(src, fmt, width, height)) {
+        const int packed = (width > 0 ? width : src.width()) * (fmt == PixelFormat::RGB24 ? 3 : 4);
+        const int stride = strides && strides[0] > 0 ? strides[0] : packed;
+        if (stride < packed)
+            return false;
+        if (!PixelConvert(src, fmt, width, height, data[0], stride))
+            return false;
+        if (strides)
+            strides[0] = stride;
+        return true;
+    }
+    // copy from a converted frame. strides are checked before converting, so data is not changed if any stride is too small
+    const VideoFormat vf(fmt);
+    const int planes = vf.planeCount();
+    const int w = width > 0 ? width : src.width();
+    for (int i = 0; i < planes; ++i) {
+        if (!data[i] || (strides && strides[i] > 0 && strides[i] < vf.bytesPerLine(w, i)))
+            return false;
+    }
+    const auto frame = src.to(fmt, width, height);
+    if (!frame)
+        return false;
+    for (int i = 0; i < planes; ++i) {
+        const auto buf = frame.buffer(i);
+        if (!buf || !buf->constData())
+            return false;
+    }
+    for (int i = 0; i < planes; ++i) {
+        const auto plane = frame.buffer(i)->constData();
+        const int plane_stride = frame.bytesPerLine(i);
+        const int packed = vf.bytesPerLine(frame.width(), i);
+        const int stride = strides && strides[i] > 0 ? strides[i] : packed;
+        for (int y = 0; y < frame.height(i); ++y)
+            memcpy(data[i] + (size_t)y * stride, plane + (size_t)y * plane_stride, packed);
+        if (strides)
+            strides[i] = stride;
+    }
+    return true;
+}
@@ -3,12 +3,46 @@
  */
 #include "mdk/c/global.h"
 #include "mdk/global.h"
+#include "Trace.h"
+#include <atomic>
+#include <mutex>
 #include <string.h>
 #if (_WIN32 + 0)
 #include <intrin.h>
 #endif
 using namespace std;
 using namespace MDK_NS;
+
+static const char* const kEventCategories[MDK_EventCategory_Dynamic] = {
+    nullptr,
+    "render.video",
+    "decoder.audio",
+    "decoder.video",
+    "decoder.subtitle",
+    "video",
+    "reader.buffering",
+    "thread.audio",
+    "thread.video",
+    "thread.subtitle",
+    "snapshot",
+    "cc",
+    "metadata",
+};
+// runtime interned categories, never freed. lock free lookup, insert with lock
+static atomic<const char*> event_categories[MDK_EventCategory_Max];
+static atomic<int> nb_event_categories{MDK_EventCategory_Dynamic};
+static mutex event_categories_mtx;
+
+static int find_event_category(const char* category)
+{
+    const int n = nb_event_categories.load(memory_order_acquire);
+    for (int i = MDK_EventCategory_Dynamic; i < n; ++i) {
+        if (strcmp(event_categories[i].load(memory_order_relaxed), category) == 0)
+            return i;
+    }
+    return MDK_EventCategory_Unknown;
+}
+
 extern "C" {
 
 int MDK_version()
@@ -45,6 +79,8 @@ void MDK_setGlobalOptionString(const char* key, const char* value)
 #else
     SetGlobalOption("UserAddress", __builtin_return_address(0));
 #endif
+    if (key && strcmp(key, "trace.file") == 0)
+        TraceStart(value);
     SetGlobalOption(key, string(value));
 }
 
@@ -104,4 +140,34 @@ char* MDK_strdup(const char* strSource)
     return strdup(strSource);
 #endif
 }
-} // extern "C"
\ No newline at end of file
+
+int MDK_EventCategoryId(const char* category)
+{
+    if (!category || !*category)
+        return MDK_EventCategory_Unknown;
+    for (int i = MDK_EventCategory_Unknown + 1; i < MDK_EventCategory_Dynamic; ++i) {
+        if (strcmp(kEventCategories[i], category) == 0)
+            return i;
+    }
+    if (const auto id = find_event_category(category))
+        return id;
+    const lock_guard<mutex> lock(event_categories_mtx);
+    if (const auto id = find_event_category(category)) // added by another thread
+        return id;
+    const int n = nb_event_categories.load(memory_order_relaxed);
+    if (n >= MDK_EventCategory_Max)
+        return MDK_EventCategory_Unknown;
+    event_categories[n].store(MDK_strdup(category), memory_order_relaxed);
+    nb_event_categories.store(n + 1, memory_order_release);
+    return n;
+}
+
+const char* MDK_EventCategoryName(int id)
+{
+    if (id > MDK_EventCategory_Unknown && id < MDK_EventCategory_Dynamic)
+        return kEventCategories[id];
+    if (id >= MDK_EventCategory_Dynamic && id < nb_event_categories.load(memory_order_acquire))
+        return event_categories[id].load(memory_order_relaxed);
+    return nullptr;
+}
+} // extern "C"
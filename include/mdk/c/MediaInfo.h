@@ -49,6 +49,8 @@ typedef struct mdkAudioStreamInfo {
 MDK_API void MDK_AudioStreamCodecParameters(const mdkAudioStreamInfo*, mdkAudioCodecParameters* p);
 /* see document of mdkStringMapEntry */
 MDK_API bool MDK_AudioStreamMetadata(const mdkAudioStreamInfo*, mdkStringMapEntry* entry);
+/* see document of MDK_MediaMetadataEntries */
+MDK_API int MDK_AudioStreamMetadataEntries(const mdkAudioStreamInfo*, mdkStringMapEntry* entries, int count);
 
 typedef struct mdkVideoCodecParameters {
     const char* codec;
@@ -84,6 +86,8 @@ typedef struct mdkVideoStreamInfo {
 MDK_API void MDK_VideoStreamCodecParameters(const mdkVideoStreamInfo*, mdkVideoCodecParameters* p);
 /* see document of mdkStringMapEntry */
 MDK_API bool MDK_VideoStreamMetadata(const mdkVideoStreamInfo*, mdkStringMapEntry* entry);
+/* see document of MDK_MediaMetadataEntries */
+MDK_API int MDK_VideoStreamMetadataEntries(const mdkVideoStreamInfo*, mdkStringMapEntry* entries, int count);
 MDK_API const uint8_t* MDK_VideoStreamData(const mdkVideoStreamInfo*, int* len, int flags);
 
 typedef struct mdkSubtitleCodecParameters {
@@ -106,6 +110,8 @@ typedef struct mdkSubtitleStreamInfo {
 
 MDK_API void MDK_SubtitleStreamCodecParameters(const mdkSubtitleStreamInfo*, mdkSubtitleCodecParameters* p);
 MDK_API bool MDK_SubtitleStreamMetadata(const mdkSubtitleStreamInfo*, mdkStringMapEntry* entry);
+/* see document of MDK_MediaMetadataEntries */
+MDK_API int MDK_SubtitleStreamMetadataEntries(const mdkSubtitleStreamInfo*, mdkStringMapEntry* entries, int count);
 
 typedef struct mdkChapterInfo {
     int64_t start_time;
@@ -124,6 +130,8 @@ typedef struct mdkProgramInfo {
 } mdkProgramInfo;
 
 MDK_API bool MDK_ProgramMetadata(const mdkProgramInfo*, mdkStringMapEntry* entry);
+/* see document of MDK_MediaMetadataEntries */
+MDK_API int MDK_ProgramMetadataEntries(const mdkProgramInfo*, mdkStringMapEntry* entries, int count);
 
 typedef struct mdkMediaInfo
 {
@@ -152,6 +160,27 @@ typedef struct mdkMediaInfo
 
 /* see document of mdkStringMapEntry */
 MDK_API bool MDK_MediaMetadata(const mdkMediaInfo*, mdkStringMapEntry* entry);
+/*!
+  \brief MDK_MediaMetadataEntries
+  Get all metadata entries in one call.
+  \param entries entry array. can be null to query entry count, otherwise at most count entries are filled. entries[i].priv is always null.
+  key and value strings are valid as long as info is valid.
+  \param count number of entries can be filled in array
+  \return total entry count. If it's > count, only count entries are filled
+ */
+MDK_API int MDK_MediaMetadataEntries(const mdkMediaInfo*, mdkStringMapEntry* entries, int count);
+
+/*!
+  \brief MDK_MediaInfo_retain
+  Add a reference to a media info snapshot, e.g. to share it with another thread. \sa mdkPlayerAPI.mediaInfoSnapshot
+  \return info
+ */
+MDK_API const mdkMediaInfo* MDK_MediaInfo_retain(const mdkMediaInfo* info);
+/*!
+  \brief MDK_MediaInfo_release
+  Release a reference of a media info snapshot, the snapshot is destroyed if no reference. *info is set to null
+ */
+MDK_API void MDK_MediaInfo_release(const mdkMediaInfo** info);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ * This file is part of MDK
+ * MDK SDK: https://github.com/wang-bin/mdk-sdk
+ * Free for opensource softwares or non-commercial use.
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ */
+#pragma once
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct mdkMediaInfo;
+struct mdkMediaProbe;
+
+enum {
+    MDK_MediaProbe_Canceled = -1000,
+    MDK_MediaProbe_Timeout = -1001,
+};
+
+/*!
+  \brief mdkMediaProbeCallback
+  Called in a worker thread for each url when media info is ready or failed to load. Callbacks of different urls can be called concurrently, and the order is not the same as input.
+  \param index index of url in probe() input
+  \param info media info of url, valid only in callback. null if error
+  \param error 0 if success, or MDK_MediaProbe_Canceled, MDK_MediaProbe_Timeout, or load error(<0)
+ */
+typedef struct mdkMediaProbeCallback {
+    void (*cb)(int index, const char* url, const struct mdkMediaInfo* info, int error, void* opaque);
+    void* opaque;
+} mdkMediaProbeCallback;
+
+/*!
+  \brief MDK_MediaProbe_new
+  Create a media info reader with a bounded worker pool. Each worker reuses a player to load media and unloads it as soon as media info is ready.
+  \param threads number of workers. <=0: number of cpu cores
+ */
+MDK_API struct mdkMediaProbe* MDK_MediaProbe_new(int threads);
+/*!
+  \brief MDK_MediaProbe_delete
+  Cancel all pending urls and wait for running ones.
+ */
+MDK_API void MDK_MediaProbe_delete(struct mdkMediaProbe**);
+/*!
+  \brief MDK_MediaProbe_probe
+  Add urls to probe. Return immediately, results are delivered via cb. Can be called multiple times, and new urls are probed after previous ones.
+  urls are copied.
+  \param timeout timeout of loading each url in ms, <=0: 10s, the same as Player. Uses Player.setTimeout to abort loading
+ */
+MDK_API void MDK_MediaProbe_probe(struct mdkMediaProbe*, const char* const* urls, int count, int64_t timeout, mdkMediaProbeCallback cb);
+/*!
+  \brief MDK_MediaProbe_setCache
+  Set a persistent media info cache file. Local files are looked up in cache by (path, size, modification time) before loading,
+  and a hit is returned without opening the file. Cache file is updated when cache is changed or probe is destroyed.
+  \param path cache file path. null or empty to disable cache
+  \param maxBytes max cache size. least recently used entries are evicted. <=0: 64MB
+ */
+MDK_API void MDK_MediaProbe_setCache(struct mdkMediaProbe*, const char* path, int64_t maxBytes);
+/*!
+  \brief MDK_MediaProbe_cancel
+  Cancel pending and running urls. cb is called with MDK_MediaProbe_Canceled for them.
+ */
+MDK_API void MDK_MediaProbe_cancel(struct mdkMediaProbe*);
+/*!
+  \brief MDK_MediaProbe_waitFor
+  Wait for all urls are done.
+  \param timeout in ms, <0: wait infinitely
+  \return false if timed out
+ */
+MDK_API bool MDK_MediaProbe_waitFor(struct mdkMediaProbe*, long timeout);
+
+#ifdef __cplusplus
+}
+#endif
@@ -54,6 +54,16 @@ typedef struct mdkVideoCallback {
     void* opaque;
 } mdkVideoCallback;
 
+/*!
+  \brief mdkVideoRefCallback
+  \param frame in/out. frame->object is only valid in callback. Set frame->object to an object created by mdkVideoFrameRef_new() or toRef() to replace the frame,
+  and player takes the ownership. Set null to drop the frame.
+ */
+typedef struct mdkVideoRefCallback {
+    int (*cb)(mdkVideoFrameRef* frame/*in/out*/, int track, void* opaque);
+    void* opaque;
+} mdkVideoRefCallback;
+
 typedef struct SwitchBitrateCallback {
     void (*cb)(bool, void* opaque);
     void* opaque;
@@ -77,6 +87,54 @@ typedef struct mdkTimeoutCallback {
     void* opaque;
 } mdkTimeoutCallback;
 
+/*!
+  \brief mdkBufferSegment
+  A part of a chunk for appendBuffers(), like iovec
+ */
+typedef struct mdkBufferSegment {
+    const uint8_t* data;
+    size_t size;
+} mdkBufferSegment;
+
+typedef struct mdkBufferLevel {
+    int64_t duration; /* buffered packets duration in ms, the same as buffered() */
+    int64_t bytes; /* buffered packets bytes */
+    int64_t appendedBytes; /* bytes appended by appendBuffer() and variants since setMedia() or setMediaForType() */
+} mdkBufferLevel;
+
+enum MDK_BufferWatermark {
+    MDK_BufferWatermark_Low, /* buffered duration <= low watermark, producer should append more data */
+    MDK_BufferWatermark_High, /* buffered duration >= high watermark, producer should stop appending */
+};
+
+/*!
+  \brief mdkBufferWatermarkCallback
+  Called in a watcher thread shared by all players when buffered duration reaches a watermark. Not called again until the other watermark is reached.
+  MUST return quickly, a slow callback delays checks of other players.
+ */
+typedef struct mdkBufferWatermarkCallback {
+    void (*cb)(enum MDK_BufferWatermark mark, const mdkBufferLevel* level, void* opaque);
+    void* opaque;
+} mdkBufferWatermarkCallback;
+
+/*!
+  \brief mdkApiLatency
+  Latency of a mdkPlayerAPI function of a player, recorded if global option "profiler.api" is 1 when the player is created.
+  Percentiles are from a log-linear histogram, relative error < 12.5%.
+ */
+typedef struct mdkApiLatency {
+    int slot; /* index of function in mdkPlayerAPI, i.e. offsetof(mdkPlayerAPI, fn) / sizeof(void*) */
+    const char* name; /* function name, e.g. "setMedia" */
+    int64_t count;
+    int64_t totalNs;
+    int64_t minNs;
+    int64_t maxNs;
+    int64_t p50Ns;
+    int64_t p90Ns;
+    int64_t p99Ns;
+    int64_t p999Ns;
+} mdkApiLatency;
+
 /*!
   \brief MediaEventCallback
   \return true if event is processed and should stop dispatching.
@@ -127,6 +185,31 @@ typedef struct mdkSnapshotCallback {
     void* opaque;
 } mdkSnapshotCallback;
 
+/*!
+  \brief mdkSnapshotBatchEntry
+  A snapshot of a player's renderer in MDK_snapshotBatch()
+ */
+typedef struct mdkSnapshotBatchEntry {
+    const struct mdkPlayerAPI* player;
+    void* vo_opaque;
+    mdkSnapshotRequest request; /* width and height MUST be > 0. data and stride are ignored, result is written to a slice of batch arena */
+    const char* file; /* optional. encode result as a file in the shared snapshot encoding threads, format is from suffix */
+} mdkSnapshotBatchEntry;
+
+typedef struct mdkSnapshotBatchResult {
+    mdkSnapshotRequest request; /* data is in batch arena, or null if snapshot failed */
+    double frameTime; /* captured frame timestamp(seconds) */
+    bool saved; /* entry file is written */
+} mdkSnapshotBatchResult;
+
+typedef struct mdkSnapshotBatchCallback {
+/* \brief cb
+   called once when all snapshots and files of a batch are done. results[i] is the result of entries[i], and valid only in callback.
+ */
+    void (*cb)(const mdkSnapshotBatchResult* results, int count, void* opaque);
+    void* opaque;
+} mdkSnapshotBatchCallback;
+
 typedef struct mdkSyncCallback {
     double (*cb)(void* opaque);
     void* opaque;
@@ -188,7 +271,11 @@ typedef struct mdkPlayerAPI {
   For accurate seek(no flag SeekFlag::Fast), the first frame is the nearest frame whose timestamp <= startPosition, but the position passed to callback is the key frame position <= startPosition
  */
     void (*prepare)(struct mdkPlayer*, int64_t startPosition, mdkPrepareCallback cb, enum MDKSeekFlag flags);
-    const struct mdkMediaInfo* (*mediaInfo)(struct mdkPlayer*); /* NOT IMPLEMENTED*/
+/*!
+  \brief mediaInfo
+  The result is valid until the next call. \sa mediaInfoChanged
+ */
+    const struct mdkMediaInfo* (*mediaInfo)(struct mdkPlayer*);
 
 /*!
   \brief setState
@@ -425,6 +512,7 @@ NOTE:
 
   If setRenderAPI() is not called by user, a default one (usually GLRenderAPI) is used, thus renderAPI() always not null.
   setRenderAPI() is not thread safe, so usually called before rendering starts, or native surface is set.
+  4. mdkHostRenderAPI renders into host memory without a gpu context. No surface is required, and renderVideo() can be called in any thread.
 */
 
 /*!
@@ -451,6 +539,7 @@ NOTE:
   \brief onSync
   \param cb a callback invoked when about to render a frame. return expected current playback position(seconds), e.g. DBL_MAX(TimestampEOS) indicates render video frame ASAP.
   sync callback clock should handle pause, resume, seek and seek finish events
+  null cb.cb: remove the callback and use the internal clock
  */
     void (*onSync)(struct mdkPlayer*, mdkSyncCallback cb, int minInterval);
 
@@ -513,11 +602,127 @@ NOTE:
     int (*bufferedTimeRanges)(struct mdkPlayer*, int64_t* t, int count);
 
     bool (*appendBuffer)(struct mdkPlayer*, const uint8_t* data, size_t size, int options);
+/*!
+  \brief videoFramePoolStats
+  mdkVideoFrameAPI objects passed to onVideo callback are recycled. A recycled object is used if the callback does not replace *pFrame.
+  \param hits number of frames delivered by a recycled object. can be null
+  \param misses number of objects allocated for frames. can be null
+  \return number of idle objects in the pool
+ */
+    int (*videoFramePoolStats)(struct mdkPlayer*, int64_t* hits, int64_t* misses);
+/*!
+  \brief mediaInfoChanged
+  Check whether mediaInfo() changed since last check, i.e. media is loaded or unloaded, or "metadata" or "decoder.video" "size" event.
+  mediaInfo() returns cached result if not changed, only duration, start time and bit rate are updated.
+  \param generation in/out. generation of last check. initial value is 0
+  \return true if changed
+ */
+    bool (*mediaInfoChanged)(struct mdkPlayer*, uint64_t* generation);
+/*!
+  \brief mediaInfoSnapshot
+  Get current media info as an immutable snapshot. Thread safe and lock free except the first call, which converts the first snapshot.
+  Snapshots are published when media is loaded, unloaded or changed by events("metadata", "decoder.video" size). Values changing without events,
+  e.g. live stream duration and realtime bit rate, are the values when the snapshot is published, use mediaInfo() to read the latest.
+  Unlike mediaInfo(), the result is not changed by later calls and is valid after player is destroyed.
+  \return never null, an empty info if no media is loaded. MUST be released by MDK_MediaInfo_release()
+ */
+    const struct mdkMediaInfo* (*mediaInfoSnapshot)(struct mdkPlayer*);
+/*!
+  \brief setEventQueue
+  Enable an event queue as an alternative of onEvent() callbacks. Events are queued by the thread raising them without lock or allocation, and drained by pollEvents().
+  \param capacity max number of queued events, rounded up to a power of 2. New events are dropped if queue is full. <= 0: disable the queue
+ */
+    void (*setEventQueue)(struct mdkPlayer*, int capacity);
+/*!
+  \brief pollEvents
+  Take queued events in order. Usually called in render or game loop thread.
+  \param events array to store events
+  \param count max number of events to take
+  \param dropped number of events dropped since last call because queue is full. can be null
+  \return number of events stored in array
+ */
+    int (*pollEvents)(struct mdkPlayer*, mdkEventRecord* events, int count, int* dropped);
+/*!
+  \brief onEventMask
+  The same as onEvent(), but cb is called only for categories in mask.
+  \param mask bits of category ids, e.g. MDK_EVENT_CATEGORY_BIT(MDK_EventCategory_RenderVideo) | MDK_EVENT_CATEGORY_BIT(MDK_EventCategory_DecoderVideo).
+  A category without an id(MDK_EventCategory_Unknown) is in mask if bit 0 is set.
+  Category id of an event is computed once for all listeners and the event queue, and a listener not in mask costs only a bit test
+ */
+    void (*onEventMask)(struct mdkPlayer*, mdkMediaEventCallback cb, uint64_t mask, MDK_CallbackToken* token);
+/*!
+  \brief appendBufferCopy
+  A copying convenience of appendBuffer(): data is copied as appendBuffer(), then buf is released by bufDeleter(&buf) before return, even if append failed.
+  NOT a zero-copy api, buf is never kept by player. Useful if a caller releases buf right after appending, e.g. a packet of a receive ring.
+  \param data data in buf to append
+  \param buf user buffer object containing data
+  \param bufDeleter release buf. can be null if buf is not owned
+ */
+    bool (*appendBufferCopy)(struct mdkPlayer*, const uint8_t* data, size_t size, void* buf, void (*bufDeleter)(void** pBuf), int options);
+/*!
+  \brief appendBuffers
+  Append a chunk split into segments without flattening, the same as appendBuffer() for each segment in order. Data is copied.
+  \param options options of the chunk, used by the last non-empty segment. other segments are appended with 0
+  \return false if a segment is failed to append. segments before it are already appended and not reverted, later segments are not appended
+ */
+    bool (*appendBuffers)(struct mdkPlayer*, const mdkBufferSegment* segments, int count, int options);
+/*!
+  \brief bufferLevel
+  Buffered data of "stream:" url, or any other media
+ */
+    void (*bufferLevel)(struct mdkPlayer*, mdkBufferLevel* level);
+/*!
+  \brief setBufferWatermarks
+  Flow control for appendBuffer() producers without polling buffered(). Buffered duration is checked every intervalMs in a watcher thread shared by all players.
+  The first check reports the current watermark if duration <= lowMs or >= highMs.
+  \param lowMs low watermark of buffered duration
+  \param highMs high watermark of buffered duration, MUST be > lowMs
+  \param intervalMs check interval. <=0: 50ms
+  \param cb null to stop watching. MUST not call setBufferWatermarks() in cb
+ */
+    void (*setBufferWatermarks)(struct mdkPlayer*, int64_t lowMs, int64_t highMs, int intervalMs, mdkBufferWatermarkCallback cb);
+/*!
+  \brief snapshotToFile
+  Take a snapshot as snapshot(), and encode renderer readback to file in snapshot thread without a user callback.
+  When done, a MediaEvent is dispatched by this C api to its onEvent() listeners and event queue, not by player, so handlers added to mdk runtime Player directly do not receive it: category "snapshot", detail is file, error is 0, or -1 if failed.
+  No event is dispatched if player is destroyed before encoding is done, but the file is still written.
+  \param request can be null. width, height and subtitle are used, data and stride are ignored
+  \param file MUST not be null, otherwise nothing is done
+  \param format image format, e.g. "jpeg", "png". null: from file suffix
+ */
+    void (*snapshotToFile)(struct mdkPlayer*, const mdkSnapshotRequest* request, const char* file, const char* format, void* vo_opaque);
+/*!
+  \brief latencyStats
+  Snapshot latency histograms of called functions of this player, in function order.
+  \param stats array to store results. can be null to get the number of called functions
+  \param reset clear histograms after snapshot
+  \return number of called functions, or 0 if "profiler.api" is not enabled
+ */
+    int (*latencyStats)(struct mdkPlayer*, mdkApiLatency* stats, int count, bool reset);
+/*!
+  \brief onVideoRef
+  The same as onVideo(), but the frame is a compact handle on stack, no frame object is allocated or recycled.
+  Called after onVideo() callback if both are set. cb.opaque null: remove the callback
+ */
+    void (*onVideoRef)(struct mdkPlayer*, mdkVideoRefCallback cb);
 } mdkPlayerAPI;
 
 MDK_API const mdkPlayerAPI* mdkPlayerAPI_new();
 MDK_API void mdkPlayerAPI_delete(const struct mdkPlayerAPI**);
 MDK_API void MDK_foreignGLContextDestroyed();
+/*!
+  \brief MDK_snapshotBatchArenaSize
+  Arena bytes required by MDK_snapshotBatch() for entries. Each entry slice is width * height bgra with 64 bytes aligned stride.
+ */
+MDK_API size_t MDK_snapshotBatchArenaSize(const mdkSnapshotBatchEntry* entries, int count);
+/*!
+  \brief MDK_snapshotBatch
+  Take snapshots of many players(or renderers of a player) at once, see snapshot(). Results are written to a caller provided arena,
+  files are encoded in snapshot encoding threads shared by all batches, and cb is called once when all entries are done.
+  \param arena at least MDK_snapshotBatchArenaSize() bytes, MUST be valid until cb is finished
+  \return false if no snapshot is requested, e.g. an entry is invalid or arena is too small. cb is not called then
+ */
+MDK_API bool MDK_snapshotBatch(const mdkSnapshotBatchEntry* entries, int count, uint8_t* arena, size_t arenaSize, mdkSnapshotBatchCallback cb);
 
 #ifdef __cplusplus
 }
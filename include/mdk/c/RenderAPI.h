@@ -9,6 +9,7 @@
  */
 #pragma once
 #include "global.h"
+#include "VideoFrame.h"
 
 enum MDK_RenderAPI {
     MDK_RenderAPI_Invalid,
@@ -17,6 +18,7 @@ enum MDK_RenderAPI {
     MDK_RenderAPI_Metal = 3,
     MDK_RenderAPI_D3D11 = 4,
     MDK_RenderAPI_D3D12 = 5,
+    MDK_RenderAPI_Host = 64, /* cpu only, implemented by C api. see mdkHostRenderAPI */
 };
 
 /*!
@@ -231,3 +233,25 @@ struct mdkVulkanRenderAPI {
     //const char*
     uint8_t reserved_opt[32]; // color space etc.
 };
+
+/*!
+  \brief mdkHostRenderAPI
+  Render into host memory without a gpu context, e.g. on servers. renderVideo() converts the next frame into a ring of host buffers,
+  and the result is read from renderAPI(vo_opaque) as a read only view of the buffer, no extra copy.
+  Frames are delivered to a host renderer after onVideo() callback, and render callback is called with vo_opaque when a frame is received.
+ */
+struct mdkHostRenderAPI {
+    enum MDK_RenderAPI type; /* MDK_RenderAPI_Host */
+/*** Render Target Options, set by user ***/
+    enum MDK_PixelFormat format; /* packed rgb: RGBA, RGBX, BGRA, BGRX or RGB24. MDK_PixelFormat_Unknown: RGBA. other formats are replaced by RGBA in renderAPI(vo_opaque) */
+    int width; /* output size. <= 0: frame size */
+    int height;
+    int buffers; /* number of host buffers in ring, also the max number of queued frames. <= 0: 3 */
+/*** Render Result, set in renderVideo() ***/
+    const uint8_t* data; /* the last rendered buffer, valid until `buffers` more frames are rendered or render api is changed */
+    int stride;
+    int outWidth;
+    int outHeight;
+    double timestamp; /* timestamp of rendered frame in seconds */
+    int8_t reserved[32];
+};
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ * This file is part of MDK
+ * MDK SDK: https://github.com/wang-bin/mdk-sdk
+ * Free for opensource softwares or non-commercial use.
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ */
+#pragma once
+#include "global.h"
+#include "VideoFrame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct mdkThumbnailer;
+
+enum {
+    MDK_Thumbnail_Canceled = -1000,
+    MDK_Thumbnail_Timeout = -1001,
+    MDK_Thumbnail_ConvertError = -1002,
+    MDK_Thumbnail_NoFrame = -1003, /* no frame decoded at timestamp, e.g. after the end */
+    MDK_Thumbnail_EncodeError = -1004,
+    MDK_Thumbnail_InvalidArgument = -1005, /* invalid request, e.g. null url or data, count or size <= 0, unsupported output format */
+};
+
+/*!
+  \brief mdkThumbnailRequest
+  Thumbnails of a media at given timestamps, or at start + i * interval if timestamps is null.
+  Output is packed rgb: MDK_PixelFormat_RGBA, RGBX, BGRA, BGRX or RGB24.
+ */
+typedef struct mdkThumbnailRequest {
+    const char* url;
+    const int64_t* timestamps; /* in ms, relative to media start time. can be null */
+    int count;
+    int64_t start; /* if timestamps is null */
+    int64_t interval; /* if timestamps is null */
+    int width; /* output size, MUST be > 0 */
+    int height;
+    enum MDK_PixelFormat format; /* MDK_PixelFormat_Unknown: RGBA */
+    bool exact; /* decode the exact frame at each timestamp. default is the nearest key frame, which is much faster. nearby timestamps decode forward without a seek, see global option "thumbnail.forward_frames" */
+    int64_t timeout; /* load or seek timeout in ms. <= 0: 10s */
+    uint8_t* const* data; /* count buffers, data[i] is the output of timestamp i. a buffer size is height * stride */
+    int stride; /* <= 0: width * bytes per pixel */
+} mdkThumbnailRequest;
+
+/*!
+  \brief mdkThumbnailCallback
+  Called in generate() thread for each timestamp in ascending timestamp order, not input order.
+  \param index index of timestamp, data[index] is written if error is 0
+  \param timestamp requested timestamp in ms
+  \param frameTime timestamp of decoded frame in ms, i.e. VideoFrame.timestamp() * 1000. can be different from timestamp if not exact
+  \param error 0 if success, MDK_Thumbnail_Canceled, MDK_Thumbnail_Timeout, MDK_Thumbnail_ConvertError, MDK_Thumbnail_NoFrame, or seek error(<0)
+  \return false to stop generating
+ */
+typedef struct mdkThumbnailCallback {
+    bool (*cb)(int index, int64_t timestamp, int64_t frameTime, int error, void* opaque);
+    void* opaque;
+} mdkThumbnailCallback;
+
+/*!
+  \brief mdkSpriteSheetRequest
+  Tiles are placed row by row in ascending timestamp order, and a sheet is encoded and released as soon as its last tile is done,
+  so only one sheet is in memory.
+ */
+typedef struct mdkSpriteSheetRequest {
+    mdkThumbnailRequest thumbnail; /* width and height are tile size. format, data and stride are ignored */
+    int columns; /* tiles per row. <= 0: 10 */
+    int rows; /* max rows per sheet. <= 0: 10. sheet buffer is columns * rows tiles, e.g. 10x10 tiles of 320x180 is 23MB. more tiles are in more sheets */
+    const char* file; /* sheet file, encoded by suffix(jpg, webp, png etc.) as VideoFrame.save. "%d" is replaced by sheet index */
+    float quality; /* encode quality in [0, 1]. < 0: default */
+    const char* vttFile; /* optional WebVTT file of tiles for players' seek preview. sheets are referenced by file name without dir */
+} mdkSpriteSheetRequest;
+
+/*!
+  \brief MDK_Thumbnailer_new
+  Create a thumbnail generator. It owns a hidden player without audio and rendering, and decoders are reused for all timestamps.
+ */
+MDK_API struct mdkThumbnailer* MDK_Thumbnailer_new();
+MDK_API void MDK_Thumbnailer_delete(struct mdkThumbnailer**);
+/*!
+  \brief MDK_Thumbnailer_generate
+  Load url and decode frames in ascending timestamp order with one forward pass of seeks, scale each frame to request size and write to request data.
+  Blocks until all timestamps are done, canceled, or cb returns false. Thumbnailer can be reused for another url.
+  \return number of thumbnails written, or a negative error: MDK_Thumbnail_InvalidArgument if request is invalid or format is not supported, or a load error if media can not be loaded
+ */
+MDK_API int MDK_Thumbnailer_generate(struct mdkThumbnailer*, const mdkThumbnailRequest* request, mdkThumbnailCallback cb);
+/*!
+  \brief MDK_Thumbnailer_generateSpriteSheet
+  Generate thumbnails as generate() but write them into tiles of sprite sheets. cb can be null, index in cb is tile index.
+  \return number of sheets written, or a negative error: MDK_Thumbnail_InvalidArgument if request is invalid, a load error if media can not be loaded, or MDK_Thumbnail_EncodeError if a sheet can not be encoded
+ */
+MDK_API int MDK_Thumbnailer_generateSpriteSheet(struct mdkThumbnailer*, const mdkSpriteSheetRequest* request, mdkThumbnailCallback cb);
+/*!
+  \brief MDK_Thumbnailer_cancel
+  Stop running generate() from another thread. Remaining timestamps are reported as MDK_Thumbnail_Canceled.
+ */
+MDK_API void MDK_Thumbnailer_cancel(struct mdkThumbnailer*);
+
+#ifdef __cplusplus
+}
+#endif
@@ -65,6 +65,18 @@ enum MDK_PixelFormat {
     MDK_PixelFormat_BGRAF32, // name: "bgraf32le"
 };
 
+struct mdkVideoFrameAPI;
+/*!
+  \brief mdkVideoFrameRef
+  Compact frame handle of 2 pointers: a frame object and the function table shared by all frames(mdkVideoFrameAPI_table()).
+  Call functions by ref.api->FN(ref.object, ...). No table is written for a frame, unlike mdkVideoFrameAPI objects, which is kept for compatibility.
+  Produced by mdkVideoFrameRef_new(), mdkVideoFrameAPI.toRef() and mdkPlayerAPI.onVideoRef().
+ */
+typedef struct mdkVideoFrameRef {
+    const struct mdkVideoFrameAPI* api;
+    struct mdkVideoFrame* object;
+} mdkVideoFrameRef;
+
 typedef struct mdkVideoFrameAPI {
     struct mdkVideoFrame* object;
 
@@ -79,6 +91,13 @@ typedef struct mdkVideoFrameAPI {
     void (*setTimestamp)(struct mdkVideoFrame*, double t);
     double (*timestamp)(struct mdkVideoFrame*);
 
+/*!
+  \brief to
+  Convert and scale to a new frame in host memory. See VideoFrame::to() in cpp api.
+  The SIMD fast path(NV12, YUV420P and P010LE in host memory to RGBA, BGRA or RGB24 in the same or half size) and its multi-threaded slicing for large frames
+  are used only if "videoframe.convert.matrix" global option is set, because frame color info is not available in C api. They are OFF by default,
+  then the runtime converts the frame. toBuffers() and toRef() are the same.
+ */
     struct mdkVideoFrameAPI* (*to)(struct mdkVideoFrame*, enum MDK_PixelFormat format, int width/*= -1*/, int height/*= -1*/);
     bool (*save)(struct mdkVideoFrame*, const char* fileName, const char* format, float quality);
 
@@ -98,19 +117,81 @@ typedef struct mdkVideoFrameAPI {
     bool (*fromVk)();
     bool (*fromGL)();
     bool (*toHost)(struct mdkVideoFrame*);
-    void* reserved[12];
+/*!
+  \brief toBuffers
+  Convert and scale into caller provided planes, the same result as to().
+  Host memory NV12, YUV420P and P010LE to RGBA, BGRA or RGB24 are converted into data directly if "videoframe.convert.matrix" global option is set.
+  Otherwise the frame is converted by to() to a temporary frame, which is allocated, then copied into data.
+  \param data planes of output format. MUST be large enough for height rows of strides
+  \param strides in/out. strides of data. if null or strides[i] <= 0, rows are tightly packed, and the packed stride is written back to strides[i] if strides is not null
+  \return false if failed, or strides[i] > 0 but less than a packed row. data is not changed if a stride is too small
+ */
+    bool (*toBuffers)(struct mdkVideoFrame*, enum MDK_PixelFormat format, int width/*= -1*/, int height/*= -1*/, uint8_t* const* data, int* strides/*in/out = nullptr*/);
+/*!
+  \brief toRef
+  The same as to(), but the result is a compact handle. Release by mdkVideoFrameRef_delete()
+  \return ref.object is null if failed
+ */
+    mdkVideoFrameRef (*toRef)(struct mdkVideoFrame*, enum MDK_PixelFormat format, int width/*= -1*/, int height/*= -1*/);
+    void* reserved[10];
 } mdkVideoFrameAPI;
 
 
 MDK_API mdkVideoFrameAPI* mdkVideoFrameAPI_new(int width/*=0*/, int height/*=0*/, enum MDK_PixelFormat format/*=Unknown*/);
 MDK_API void mdkVideoFrameAPI_delete(struct mdkVideoFrameAPI**);
 
+/*!
+  \brief mdkVideoFrameAPI_table
+  The function table shared by all frames. object member is null.
+  Functions can be called with any frame object without a per-frame table, e.g. mdkVideoFrameAPI_table()->width(frame->object, -1)
+ */
+MDK_API const mdkVideoFrameAPI* mdkVideoFrameAPI_table();
+
+MDK_API mdkVideoFrameRef mdkVideoFrameRef_new(int width/*=0*/, int height/*=0*/, enum MDK_PixelFormat format/*=Unknown*/);
+/* release ref->object and set null */
+MDK_API void mdkVideoFrameRef_delete(mdkVideoFrameRef* ref);
+
 /*
   \brief mdkVideoBufferPoolFree
   free *pool and set null
 */
 MDK_API void mdkVideoBufferPoolFree(mdkVideoBufferPool** pool);
 
+/*!
+  \brief mdkFrameBufferPool
+  Host memory for frames of the same (format, width, height, alignment), e.g. frames for Player.enqueueVideo().
+  Memory of a destroyed frame is kept in the pool and reused by the next frame of the same parameters.
+  Thread safe. A frame can outlive the pool.
+ */
+struct mdkFrameBufferPool;
+
+typedef struct mdkFrameBufferPoolStats {
+    int64_t hits; /* frames allocated from pooled memory */
+    int64_t misses; /* frames allocated from new memory */
+    int usedBlocks; /* memory blocks owned by frames */
+    int freeBlocks; /* memory blocks in pool */
+    int64_t usedBytes;
+    int64_t freeBytes;
+} mdkFrameBufferPoolStats;
+
+/*!
+  \param maxFreeBlocks max free blocks kept for each (format, width, height, alignment). <=0: 4
+ */
+MDK_API struct mdkFrameBufferPool* mdkFrameBufferPool_new(int maxFreeBlocks);
+/* free *pool and set null. memory of alive frames is freed when frames are destroyed */
+MDK_API void mdkFrameBufferPool_delete(struct mdkFrameBufferPool** pool);
+/*!
+  \brief mdkFrameBufferPool_newFrame
+  Create a frame with uninitialized planes allocated from pool in a single block. Release by mdkVideoFrameAPI_delete(), or pass to an api taking the ownership.
+  Use bufferData() and bytesPerLine() to write planes.
+  \param alignment plane address and stride alignment, MUST be power of 2. <=0: 64
+  \return null if format is invalid or out of memory
+ */
+MDK_API mdkVideoFrameAPI* mdkFrameBufferPool_newFrame(struct mdkFrameBufferPool* pool, int width, int height, enum MDK_PixelFormat format, int alignment);
+/* release free memory blocks */
+MDK_API void mdkFrameBufferPool_clear(struct mdkFrameBufferPool* pool);
+MDK_API void mdkFrameBufferPool_stats(struct mdkFrameBufferPool* pool, mdkFrameBufferPoolStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -193,6 +193,9 @@ https://github.com/wang-bin/mdk-sdk/wiki/Global-Options
  - "logLevel" or "log": can be "Off", "Error", "Warning", "Info", "Debug", "All". same as SetGlobalOption("logLevel", int(LogLevel))
  - "profiler.gpu": "0" or "1"
  - "R3DSDK_DIR": R3D dlls dir. default dir is working dir
+ - "videoframe.convert.matrix": "bt601", "bt709" or "bt2020". color matrix of host memory NV12, YUV420P and P010LE frames converted by VideoFrame.to() and toBuffers(). if set, such frames are converted to RGBA, BGRA or RGB24 in a SIMD fast path, otherwise by the runtime. P010LE frames use 16bit SIMD kernels(SSE4.1, AVX2 or NEON). default is not set, because frame color info is not available in C api
+ - "videoframe.convert.range": "limited"(default) or "full". color range of frames converted in VideoFrame.to() fast path
+ - "trace.file": record C api player events(prepare, seek, onVideo, render callback, MediaEvent) to a chrome trace json file for chrome://tracing or ui.perfetto.dev. empty: stop recording and finish the file
 */
 MDK_API void MDK_setGlobalOptionString(const char* key, const char* value);
 /*
@@ -207,6 +210,10 @@ MDK_API void MDK_setGlobalOptionString(const char* key, const char* value);
         - 1: default. prefer io module
         - 2: always use io module for all protocols
   - "demuxer.live_eos_timeout": read error if no data for the given milliseconds for a live stream. default is 5000
+  - "videoframe.convert.threads": N. max threads to convert a frame in VideoFrame.to() fast path, including the calling thread. <=0: default, number of cpu cores. 1: single-threaded
+  - "videoframe.convert.min_pixels": N. frames with less pixels(width x height of output) are converted in a single thread. default is 3840x2160
+  - "profiler.api": 1 to record latency histograms of mdkPlayerAPI calls for players created later, see mdkPlayerAPI.latencyStats. default is 0, no overhead
+  - "thumbnail.forward_frames": N. max frames an exact mdkThumbnailer decodes forward from the previous thumbnail instead of seeking from a key frame. default is 60. 0: always seek
 
  */
 MDK_API void MDK_setGlobalOptionInt32(const char* key, int value);
@@ -255,8 +262,66 @@ typedef struct mdkMediaEvent {
             int height;
         } video;
     };
+    int category_id; /* interned id of category. \sa MDK_EventCategory, MDK_EventCategoryId() */
 } mdkMediaEvent;
 
+/*!
+  \brief MDK_EventCategory
+  Interned id of mdkMediaEvent.category. Known categories have fixed ids, other categories are interned at runtime by MDK_EventCategoryId().
+ */
+typedef enum MDK_EventCategory {
+    MDK_EventCategory_Unknown = 0, /* null, empty or too many categories */
+    MDK_EventCategory_RenderVideo, /* "render.video" */
+    MDK_EventCategory_DecoderAudio, /* "decoder.audio" */
+    MDK_EventCategory_DecoderVideo, /* "decoder.video" */
+    MDK_EventCategory_DecoderSubtitle, /* "decoder.subtitle" */
+    MDK_EventCategory_Video, /* "video" */
+    MDK_EventCategory_ReaderBuffering, /* "reader.buffering" */
+    MDK_EventCategory_ThreadAudio, /* "thread.audio" */
+    MDK_EventCategory_ThreadVideo, /* "thread.video" */
+    MDK_EventCategory_ThreadSubtitle, /* "thread.subtitle" */
+    MDK_EventCategory_Snapshot, /* "snapshot" */
+    MDK_EventCategory_CC, /* "cc" */
+    MDK_EventCategory_Metadata, /* "metadata" */
+    MDK_EventCategory_Dynamic, /* the first runtime interned id */
+    MDK_EventCategory_Max = 64, /* max number of ids */
+} MDK_EventCategory;
+
+/* event subscription mask bit of a category id. \sa mdkPlayerAPI.onEventMask */
+#define MDK_EVENT_CATEGORY_BIT(id) (1ULL << (id))
+#define MDK_EVENT_CATEGORY_ALL (~0ULL)
+
+/*!
+  \brief MDK_EventCategoryId
+  Get id of a category, a new id is assigned if not interned yet. Thread safe.
+  \return MDK_EventCategory value, or a runtime id in [MDK_EventCategory_Dynamic, MDK_EventCategory_Max), or MDK_EventCategory_Unknown if no id available
+ */
+MDK_API int MDK_EventCategoryId(const char* category);
+/*!
+  \brief MDK_EventCategoryName
+  \return category string of id, or null if id is not assigned
+ */
+MDK_API const char* MDK_EventCategoryName(int id);
+
+/*!
+  \brief mdkEventRecord
+  A queued event. \sa mdkPlayerAPI.pollEvents
+ */
+typedef struct mdkEventRecord {
+    int64_t error; /* the same as mdkMediaEvent.error */
+    int category; /* category id. \sa MDK_EventCategoryName() */
+    union {
+        struct {
+            int stream;
+        } decoder;
+        struct {
+            int width;
+            int height;
+        } video;
+    };
+    char detail[64]; /* mdkMediaEvent.detail, truncated if too long. always null terminated */
+} mdkEventRecord;
+
 /*
 bool MDK_SomeFunc(SomeStruct*, mdkStringMapEntry* entry)
 entry: in/out, can not be null.
@@ -264,7 +329,8 @@ Input entry->priv is null:
 The result entry points to the first entry containing the same key as entry->key, or the first entry if entry->key is null.
 The result entry->priv is set to a new value by api.
 Input entry->priv is not null(set by the api): the result entry points to the next entry.
-return: true if entry is found, false if not.
+return: true if entry is found, false if not. entry->priv is reset to null if not found.
+To get all entries, MDK_*MetadataEntries() is faster.
 */
 typedef struct mdkStringMapEntry {
     const char* key;    /* input: set by user to query .value field if priv is null
@@ -9,6 +9,8 @@
  */
 #pragma once
 #include "MediaInfo.h"
+#include "MediaProbe.h"
 #include "VideoFrame.h"
 #include "RenderAPI.h"
 #include "Player.h"
+#include "Thumbnail.h"
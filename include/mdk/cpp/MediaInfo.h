@@ -10,6 +10,7 @@
 #pragma once
 #include "global.h"
 #include "../c/MediaInfo.h"
+#include <algorithm>
 #include <cstring>
 #include <unordered_map>
 #include <vector>
@@ -131,6 +132,23 @@ struct MediaInfo
 };
 
 // the following functions MUST be built into user's code because user's c++ stl abi is unknown
+template<class Info>
+static void metadata_from_c(const Info* info, int (*getEntries)(const Info*, mdkStringMapEntry*, int), std::unordered_map<std::string, std::string>& metadata)
+{
+    mdkStringMapEntry e[32];
+    const mdkStringMapEntry* entries = e;
+    std::vector<mdkStringMapEntry> ev;
+    auto count = getEntries(info, e, 32);
+    if (count > 32) {
+        ev.resize(count);
+        count = std::min<int>(count, getEntries(info, ev.data(), count));
+        entries = ev.data();
+    }
+    metadata.reserve(count);
+    for (int i = 0; i < count; ++i)
+        metadata.emplace(entries[i].key, entries[i].value);
+}
+
 // used by Player.mediaInfo()
 static void from_c(const mdkMediaInfo* cinfo, MediaInfo* info)
 {
@@ -144,9 +162,7 @@ static void from_c(const mdkMediaInfo* cinfo, MediaInfo* info)
     info->format = cinfo->format;
     info->streams = cinfo->streams;
 
-    mdkStringMapEntry entry{};
-    while (MDK_MediaMetadata(cinfo, &entry))
-        info->metadata[entry.key] = entry.value;
+    metadata_from_c(cinfo, MDK_MediaMetadataEntries, info->metadata);
     for (int i = 0; i < cinfo->nb_chapters; ++i) {
         const auto& cci = cinfo->chapters[i];
         ChapterInfo ci;
@@ -164,9 +180,7 @@ static void from_c(const mdkMediaInfo* cinfo, MediaInfo* info)
         si.duration = csi.duration;
         si.frames = csi.frames;
         MDK_AudioStreamCodecParameters(&csi, (mdkAudioCodecParameters*)&si.codec);
-        mdkStringMapEntry e{};
-        while (MDK_AudioStreamMetadata(&csi, &e))
-            si.metadata[e.key] = e.value;
+        metadata_from_c(&csi, MDK_AudioStreamMetadataEntries, si.metadata);
         info->audio.push_back(std::move(si));
     }
     for (int i = 0; i < cinfo->nb_video; ++i) {
@@ -178,9 +192,7 @@ static void from_c(const mdkMediaInfo* cinfo, MediaInfo* info)
         si.frames = csi.frames;
         si.rotation = csi.rotation;
         MDK_VideoStreamCodecParameters(&csi, (mdkVideoCodecParameters*)&si.codec);
-        mdkStringMapEntry e{};
-        while (MDK_VideoStreamMetadata(&csi, &e))
-            si.metadata[e.key] = e.value;
+        metadata_from_c(&csi, MDK_VideoStreamMetadataEntries, si.metadata);
         si.image_data = MDK_VideoStreamData(&csi, &si.image_size, 0);
         info->video.push_back(std::move(si));
     }
@@ -191,9 +203,7 @@ static void from_c(const mdkMediaInfo* cinfo, MediaInfo* info)
         si.start_time = csi.start_time;
         si.duration = csi.duration;
         MDK_SubtitleStreamCodecParameters(&csi, (mdkSubtitleCodecParameters*)&si.codec);
-        mdkStringMapEntry e{};
-        while (MDK_SubtitleStreamMetadata(&csi, &e))
-            si.metadata[e.key] = e.value;
+        metadata_from_c(&csi, MDK_SubtitleStreamMetadataEntries, si.metadata);
         info->subtitle.push_back(std::move(si));
     }
     for (int i = 0; i < cinfo->nb_programs; ++i) {
@@ -201,9 +211,7 @@ static void from_c(const mdkMediaInfo* cinfo, MediaInfo* info)
         ProgramInfo pi;
         pi.id = cpi.id;
         pi.stream.assign(cpi.stream, cpi.stream + cpi.nb_stream);
-        mdkStringMapEntry e{};
-        while (MDK_ProgramMetadata(&cpi, &e))
-            pi.metadata[e.key] = e.value;
+        metadata_from_c(&cpi, MDK_ProgramMetadataEntries, pi.metadata);
         info->program.push_back(std::move(pi));
     }
 }
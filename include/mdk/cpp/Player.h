@@ -13,11 +13,14 @@
 #include "RenderAPI.h"
 #include "../c/Player.h"
 #include "VideoFrame.h"
+#include <atomic>
 #include <cinttypes>
 #include <cstdlib>
 #include <map>
 #include <mutex>
 #include <set>
+#include <thread>
+#include <utility>
 #include <vector>
 
 MDK_NS_BEGIN
@@ -31,6 +34,142 @@ MDK_NS_BEGIN
  */
 using PrepareCallback = std::function<bool(int64_t position, bool* boost)>;
 
+/*!
+  \brief CallbackHazards
+  Hazard slots shared by callback slots of a player. An invoker announces the callback it is running in a slot, and a replaced callback
+  is retired, then destroyed by a later retire() or the destructor once no slot announces it. Slots are picked by thread id hash, so an
+  invoker writes to a cache line of its own in most cases.
+ */
+class CallbackHazards
+{
+public:
+    struct alignas(64) Slot {
+        std::atomic_flag busy = ATOMIC_FLAG_INIT;
+        std::atomic<const void*> hazard{nullptr};
+    };
+
+    CallbackHazards() = default;
+    CallbackHazards(const CallbackHazards&) = delete;
+    CallbackHazards& operator=(const CallbackHazards&) = delete;
+
+    ~CallbackHazards() {
+        for (auto& r : retired_) {
+            while (announced(r.first)) // no invoker if owner stopped callbacks before destroying slots
+                std::this_thread::yield();
+            r.second(r.first);
+        }
+    }
+
+    // more than kSlots concurrent invokers spin
+    Slot& claim() {
+        size_t i = std::hash<std::thread::id>()(std::this_thread::get_id());
+        while (true) {
+            auto& s = slots_[i++ % kSlots];
+            if (!s.busy.test_and_set(std::memory_order_acquire))
+                return s;
+            if (i % kSlots == 0)
+                std::this_thread::yield();
+        }
+    }
+
+    // p can be null. destroy retired objects not announced, never waits for a running callback
+    void retire(const void* p, void (*deleter)(const void*)) {
+        const std::lock_guard<std::mutex> lock(mtx_);
+        if (p)
+            retired_.emplace_back(p, deleter);
+        for (auto it = retired_.begin(); it != retired_.end();) {
+            if (announced(it->first)) {
+                ++it;
+                continue;
+            }
+            it->second(it->first);
+            it = retired_.erase(it);
+        }
+    }
+private:
+    bool announced(const void* p) const {
+        for (const auto& s : slots_) {
+            if (s.hazard.load() == p)
+                return true;
+        }
+        return false;
+    }
+
+    static constexpr size_t kSlots = 16;
+    Slot slots_[kSlots];
+    std::mutex mtx_; // retire()
+    std::vector<std::pair<const void*, void (*)(const void*)>> retired_;
+};
+
+/*!
+  \brief CallbackSlot
+  A callback set by user and invoked by internal threads. get() announces the current callback in a hazard slot until the returned Ref is destroyed,
+  no lock is held and no reference count is changed, so invoking is a few atomic operations on a cache line of the calling thread.
+  set() never waits for a running callback, and the old callback is destroyed after the last running invocation.
+  Lock free, not wait-free: get() retries if set() is called concurrently, and spins if more than CallbackHazards::kSlots invokers are running.
+ */
+template<typename F>
+class CallbackSlot
+{
+public:
+    using Fn = std::function<F>;
+
+    class Ref {
+    public:
+        Ref(CallbackHazards::Slot* s, const Fn* f) : s_(s), f_(f) {}
+        Ref(const Ref&) = delete;
+        Ref& operator=(const Ref&) = delete;
+        Ref(Ref&& that) : s_(that.s_), f_(that.f_) { that.s_ = nullptr; }
+        ~Ref() {
+            if (!s_)
+                return;
+            s_->hazard.store(nullptr, std::memory_order_release);
+            s_->busy.clear(std::memory_order_release);
+        }
+
+        explicit operator bool() const { return f_; }
+        const Fn& operator*() const { return *f_; }
+    private:
+        CallbackHazards::Slot* s_;
+        const Fn* f_;
+    };
+
+    explicit CallbackSlot(CallbackHazards& hazards) : h_(hazards) {}
+    CallbackSlot(const CallbackSlot&) = delete;
+    CallbackSlot& operator=(const CallbackSlot&) = delete;
+
+    ~CallbackSlot() {
+        h_.retire(f_.exchange(nullptr), &destroy);
+    }
+
+    void set(const Fn& cb) {
+        h_.retire(f_.exchange(cb ? new Fn(cb) : nullptr), &destroy);
+    }
+
+    Ref get() const {
+        auto& s = h_.claim();
+        auto f = f_.load();
+        while (f) {
+            s.hazard.store(f);
+            const auto g = f_.load(); // f is not destroyed if still current after it's announced
+            if (g == f)
+                break;
+            f = g;
+        }
+        if (!f) {
+            s.hazard.store(nullptr, std::memory_order_release);
+            s.busy.clear(std::memory_order_release);
+            return Ref(nullptr, nullptr);
+        }
+        return Ref(&s, f);
+    }
+private:
+    static void destroy(const void* f) { delete static_cast<const Fn*>(f); }
+
+    CallbackHazards& h_;
+    std::atomic<const Fn*> f_{nullptr};
+};
+
 /*!
  * \brief The Player class
  * High level API with basic playback function.
@@ -132,6 +271,67 @@ examples:
     bool appendBuffer(const uint8_t* data, size_t size, int options = 0) {
         return MDK_CALL(p, appendBuffer, data, size, options);
     }
+/*!
+  \brief appendBufferCopy
+  Copy data as appendBuffer(), then release buf by bufDeleter(&buf) before return, even if failed. Not zero-copy, buf is never kept.
+ */
+    bool appendBufferCopy(const uint8_t* data, size_t size, void* buf, void (*bufDeleter)(void** pBuf), int options = 0) {
+        return MDK_CALL2(p, appendBufferCopy, data, size, buf, bufDeleter, options);
+    }
+/*!
+  \brief appendBuffer
+  Append a chunk split into segments without flattening, the same as appendBuffer() for each segment in order. options are used by the last non-empty segment.
+  If false, segments before the failed one are already appended.
+ */
+    bool appendBuffer(const mdkBufferSegment* segments, int count, int options = 0) {
+        return MDK_CALL2(p, appendBuffers, segments, count, options);
+    }
+/*!
+  \brief bufferLevel
+  Buffered duration and bytes, and bytes appended by appendBuffer() since setMedia()
+ */
+    mdkBufferLevel bufferLevel() const {
+        mdkBufferLevel level{};
+        MDK_CALL2(p, bufferLevel, &level);
+        return level;
+    }
+/*!
+  \brief latencyStats
+  Latency histograms of api calls of this player. Requires SetGlobalOption("profiler.api", 1) before creating the player.
+  \return number of called functions
+ */
+    int latencyStats(mdkApiLatency* stats, int count, bool reset = false) const {
+        return MDK_CALL2(p, latencyStats, stats, count, reset);
+    }
+/*!
+  \brief setBufferWatermarks
+  Flow control for appendBuffer() producers. cb is called in a watcher thread shared by all players, MUST return quickly. Called when buffered duration <= lowMs or >= highMs, and not called again until the other watermark is reached.
+  \param intervalMs check interval. <=0: 50ms
+  \param cb null to stop watching. MUST not call setBufferWatermarks() in cb
+ */
+    void setBufferWatermarks(int64_t lowMs, int64_t highMs, const std::function<void(MDK_BufferWatermark, const mdkBufferLevel&)>& cb, int intervalMs = 0) {
+        watermark_cb_.set(cb);
+        mdkBufferWatermarkCallback callback{};
+        if (cb) {
+            callback.cb = [](MDK_BufferWatermark mark, const mdkBufferLevel* level, void* opaque){
+                auto p = (Player*)opaque;
+                if (const auto f = p->watermark_cb_.get())
+                    (*f)(mark, *level);
+            };
+            callback.opaque = this;
+        }
+        MDK_CALL2(p, setBufferWatermarks, lowMs, highMs, intervalMs, callback);
+    }
+/*!
+  \brief videoFramePoolStats
+  Statistics of recycled frame objects for onFrame<VideoFrame>() callback.
+  \param hits number of frames delivered by a recycled object
+  \param misses number of frame objects allocated
+  \return number of idle objects in the pool
+ */
+    int videoFramePoolStats(int64_t* hits, int64_t* misses = nullptr) const {
+        return MDK_CALL2(p, videoFramePoolStats, hits, misses);
+    }
 
     void setPreloadImmediately(bool value = true) {
         MDK_CALL(p, setPreloadImmediately, value);
@@ -152,17 +352,14 @@ examples:
   Call before setMedia() to take effect.
  */
     void currentMediaChanged(const std::function<void()>& cb) { // call before setMedia()
-        {
-            const std::lock_guard<std::mutex> lock(current_mtx_);
-            current_cb_ = cb;
-        }
+        current_cb_.set(cb);
         mdkCurrentMediaChangedCallback callback;
         callback.cb = [](void* opaque){
             auto p = (Player*)opaque;
-            const std::lock_guard<std::mutex> lock(p->current_mtx_);
-            p->current_cb_();
+            if (const auto f = p->current_cb_.get())
+                (*f)();
         };
-        callback.opaque = current_cb_ ? this : nullptr;
+        callback.opaque = cb ? this : nullptr;
         MDK_CALL(p, currentMediaChanged, callback);
     }
 /*!
@@ -200,17 +397,15 @@ examples:
   Default timeout is 10s
  */
     void setTimeout(int64_t ms, const std::function<bool(int64_t ms)>& cb = nullptr) {
-        {
-            const std::lock_guard<std::mutex> lock(timeout_mtx_);
-            timeout_cb_ = cb;
-        }
+        timeout_cb_.set(cb);
         mdkTimeoutCallback callback;
         callback.cb = [](int64_t ms, void* opaque){
             auto p = (Player*)opaque;
-            const std::lock_guard<std::mutex> lock(p->timeout_mtx_);
-            return p->timeout_cb_(ms);
+            if (const auto f = p->timeout_cb_.get())
+                return (*f)(ms);
+            return true; // the same as null callback
         };
-        callback.opaque = timeout_cb_ ? this : nullptr;
+        callback.opaque = cb ? this : nullptr;
         MDK_CALL(p, setTimeout, ms, callback);
     }
 
@@ -247,7 +442,32 @@ examples:
   A live stream's duration is 0 in prepare() callback or when MediaStatus::Loaded is added, then duration increases current read duration.
 */
     const MediaInfo& mediaInfo() const {
-        from_c(MDK_CALL(p, mediaInfo), &info_);
+        const bool has_gen = p->size > 0 && offsetof(mdkPlayerAPI, mediaInfoChanged) < (size_t)p->size; // old runtime: always convert
+        const auto changed = !has_gen || p->mediaInfoChanged(p->object, &info_gen_); // before mediaInfo(), then changes after this call will not be lost
+        const auto cinfo = MDK_CALL(p, mediaInfo);
+        if (changed || !cinfo
+            || cinfo->nb_audio != (int)info_.audio.size() || cinfo->nb_video != (int)info_.video.size() || cinfo->nb_subtitle != (int)info_.subtitle.size()) {
+            from_c(cinfo, &info_);
+            return info_;
+        }
+        // values changed without a new generation, e.g. live stream duration
+        info_.start_time = cinfo->start_time;
+        info_.duration = cinfo->duration;
+        info_.bit_rate = cinfo->bit_rate;
+        for (int i = 0; i < cinfo->nb_audio; ++i) {
+            info_.audio[i].start_time = cinfo->audio[i].start_time;
+            info_.audio[i].duration = cinfo->audio[i].duration;
+            info_.audio[i].frames = cinfo->audio[i].frames;
+        }
+        for (int i = 0; i < cinfo->nb_video; ++i) {
+            info_.video[i].start_time = cinfo->video[i].start_time;
+            info_.video[i].duration = cinfo->video[i].duration;
+            info_.video[i].frames = cinfo->video[i].frames;
+        }
+        for (int i = 0; i < cinfo->nb_subtitle; ++i) {
+            info_.subtitle[i].start_time = cinfo->subtitle[i].start_time;
+            info_.subtitle[i].duration = cinfo->subtitle[i].duration;
+        }
         return info_;
     }
 
@@ -272,17 +492,14 @@ examples:
     }
 
     Player& onStateChanged(const std::function<void(State)>& cb) {
-        {
-            const std::lock_guard<std::mutex> lock(state_mtx_);
-            state_cb_ = cb;
-        }
+        state_cb_.set(cb);
         mdkStateChangedCallback callback;
         callback.cb = [](MDK_State value, void* opaque){
             auto p = (Player*)opaque;
-            const std::lock_guard<std::mutex> lock(p->state_mtx_);
-            p->state_cb_(State(value));
+            if (const auto f = p->state_cb_.get())
+                (*f)(State(value));
         };
-        callback.opaque = state_cb_ ? this : nullptr;
+        callback.opaque = cb ? this : nullptr;
         MDK_CALL(p, onStateChanged, callback);
         return *this;
     }
@@ -319,21 +536,17 @@ examples:
         const std::lock_guard<std::mutex> lock(status_mtx_);
         if (!cb) {
             MDK_CALL(p, onMediaStatus, callback, token ? &status_cb_key_[*token] : nullptr);
-            if (token) {
-                status_cb_.erase(*token);
-                status_cb_key_.erase(*token);
-            } else {
-                status_cb_.clear();
-                status_cb_key_.clear();
-            }
+            reset(status_cb_, status_cb_key_, token);
         } else {
             static CallbackToken k = 1;
-            status_cb_[k] = cb;
+            auto& slot = status_cb_.try_emplace(k, hazards_).first->second;
+            slot.set(cb);
             callback.cb = [](MDK_MediaStatus oldValue, MDK_MediaStatus newValue, void* opaque){
-                auto f = (std::function<bool(MediaStatus, MediaStatus)>*)opaque;
-                return (*f)(MediaStatus(oldValue), MediaStatus(newValue));
+                if (const auto f = static_cast<const CallbackSlot<bool(MediaStatus, MediaStatus)>*>(opaque)->get())
+                    return (*f)(MediaStatus(oldValue), MediaStatus(newValue));
+                return true;
             };
-            callback.opaque = &status_cb_[k]; // add/del/invoke callback(s) via c api onMediaStatus() is thread safe and can ensure address of callback is valid
+            callback.opaque = &slot; // add/del/invoke callback(s) via c api onMediaStatus() is thread safe and can ensure address of callback is valid
             CallbackToken t;
             MDK_CALL(p, onMediaStatus, callback, &t);
             status_cb_key_[k] = t;
@@ -419,6 +632,16 @@ examples:
         callback.opaque = f;
         return MDK_CALL(p, snapshot, (mdkSnapshotRequest*)request, callback, vo_opaque);
     }
+/*!
+  \brief snapshot
+  take a snapshot and encode it to file in snapshot thread. result is reported by a MediaEvent "snapshot" with detail file, error 0 or -1.
+  \param request can be null. data and stride are ignored
+  \param file MUST not be null, otherwise nothing is done
+  \param format image format, e.g. "jpeg", "png". null: from file suffix
+*/
+    void snapshot(const SnapshotRequest* request, const char* file, const char* format = nullptr, void* vo_opaque = nullptr) {
+        MDK_CALL2(p, snapshotToFile, (const mdkSnapshotRequest*)request, file, format, vo_opaque);
+    }
 
 /*
   Properties:
@@ -623,17 +846,14 @@ NOTE:
   DO NOT call renderVideo() in the callback, otherwise will results in dead lock
 */
     void setRenderCallback(const std::function<void(void* vo_opaque)>& cb) { // per vo?
-        {
-            const std::lock_guard<std::mutex> lock(render_mtx_);
-            render_cb_ = cb;
-        }
+        render_cb_.set(cb);
         mdkRenderCallback callback;
         callback.cb = [](void* vo_opaque, void* opaque){
             auto p = (Player*)opaque;
-            const std::lock_guard<std::mutex> lock(p->render_mtx_);
-            p->render_cb_(vo_opaque);
+            if (const auto f = p->render_cb_.get())
+                (*f)(vo_opaque);
         };
-        callback.opaque = render_cb_ ? this : nullptr;
+        callback.opaque = cb ? this : nullptr;
         MDK_CALL(p, setRenderCallback, callback);
     }
 
@@ -742,17 +962,14 @@ NOTE:
   \param flags seek flags for the next url, accurate or fast
  */
     void switchBitrate(const char* url, int64_t delay = -1, const std::function<void(bool)>& cb = nullptr) {
-        {
-            const std::lock_guard<std::mutex> lock(switch_mtx_);
-            switch_cb_ = cb;
-        }
+        switch_cb_.set(cb);
         SwitchBitrateCallback callback;
         callback.cb = [](bool value, void* opaque){
             auto p = (Player*)opaque;
-            const std::lock_guard<std::mutex> lock(p->switch_mtx_);
-            p->switch_cb_(value);
+            if (const auto f = p->switch_cb_.get())
+                (*f)(value);
         };
-        callback.opaque = switch_cb_ ? this : nullptr;
+        callback.opaque = cb ? this : nullptr;
         return MDK_CALL(p, switchBitrate, url, delay, callback);
     }
 /*!
@@ -763,13 +980,14 @@ NOTE:
  * This will not affect next media set by user
  */
     bool switchBitrateSingleConnection(const char *url, const std::function<void(bool)>& cb = nullptr) {
-        switch_cb_ = cb;
+        switch_cb_.set(cb);
         SwitchBitrateCallback callback;
         callback.cb = [](bool value, void* opaque){
-            auto f = (std::function<void(bool)>*)opaque;
-            (*f)(value);
+            auto p = (Player*)opaque;
+            if (const auto f = p->switch_cb_.get())
+                (*f)(value);
         };
-        callback.opaque = switch_cb_ ? (void*)&switch_cb_ : nullptr;
+        callback.opaque = cb ? this : nullptr;
         return MDK_CALL(p, switchBitrateSingleConnection, url, callback);
     }
 
@@ -779,34 +997,33 @@ NOTE:
   callback return: true if event is processed and should stop dispatching.
  */
     Player& onEvent(const std::function<bool(const MediaEvent&)>& cb, CallbackToken* token = nullptr) {
+        return onEvent(cb, MDK_EVENT_CATEGORY_ALL, token);
+    }
+/*!
+  \brief onEvent
+  Add an event listener only for categories in mask. Other events never call cb.
+  \param mask bits of category ids, e.g. MDK_EVENT_CATEGORY_BIT(MDK_EventCategory_RenderVideo). Requires a new runtime if not MDK_EVENT_CATEGORY_ALL
+ */
+    Player& onEvent(const std::function<bool(const MediaEvent&)>& cb, uint64_t mask, CallbackToken* token) {
         mdkMediaEventCallback callback{};
         const std::lock_guard<std::mutex> lock(event_mtx_);
         if (!cb) {
             MDK_CALL(p, onEvent, callback, token ? &event_cb_key_[*token] : nullptr);
-            if (token) {
-                event_cb_.erase(*token);
-                event_cb_key_.erase(*token);
-            } else {
-                event_cb_.clear();
-                event_cb_key_.clear();
-            }
+            reset(event_cb_, event_cb_key_, token);
         } else {
             static CallbackToken k = 1;
-            event_cb_[k] = cb;
-            callback.cb = [](const mdkMediaEvent* me, void* opaque){
-                auto f = (std::function<bool(const MediaEvent&)>*)opaque;
-                MediaEvent e;
-                e.error = me->error;
-                e.category = me->category;
-                e.detail = me->detail;
-                e.decoder.stream = me->decoder.stream;
-                e.video.width = me->video.width;
-                e.video.height = me->video.height;
-                return (*f)(e);
-            };
-            callback.opaque = &event_cb_[k];
+            auto& slot = event_cb_.try_emplace(k, hazards_).first->second;
+            slot.set(cb);
+            // mdkMediaEvent.category_id is available only if runtime has onEventMask
+            const bool has_mask = p->size > 0 && offsetof(mdkPlayerAPI, onEventMask) < (size_t)p->size;
+            assert((has_mask || mask == MDK_EVENT_CATEGORY_ALL) && "NOT IMPLEMENTED! Upgrade your runtime library");
+            callback.cb = has_mask ? &Player::onMediaEvent<true> : &Player::onMediaEvent<false>;
+            callback.opaque = &slot;
             CallbackToken t;
-            MDK_CALL(p, onEvent, callback, &t);
+            if (has_mask)
+                MDK_CALL2(p, onEventMask, callback, mask, &t);
+            else
+                MDK_CALL(p, onEvent, callback, &t);
             event_cb_key_[k] = t;
             if (token)
                 *token = t;
@@ -846,21 +1063,16 @@ NOTE:
         const std::lock_guard<std::mutex> lock(loop_mtx_);
         if (!cb) {
             MDK_CALL(p, onLoop, callback, token ? &loop_cb_key_[*token] : nullptr);
-            if (token) {
-                loop_cb_.erase(*token);
-                loop_cb_key_.erase(*token);
-            } else {
-                loop_cb_.clear();
-                loop_cb_key_.clear();
-            }
+            reset(loop_cb_, loop_cb_key_, token);
         } else {
             static CallbackToken k = 1;
-            loop_cb_[k] = cb;
+            auto& slot = loop_cb_.try_emplace(k, hazards_).first->second;
+            slot.set(cb);
             callback.cb = [](int countNow, void* opaque){
-                auto f = (std::function<void(int)>*)opaque;
-                return (*f)(countNow);
+                if (const auto f = static_cast<const CallbackSlot<void(int)>*>(opaque)->get())
+                    (*f)(countNow);
             };
-            callback.opaque = &loop_cb_[k];
+            callback.opaque = &slot;
             CallbackToken t;
             MDK_CALL(p, onLoop, callback, &t);
             loop_cb_key_[k] = t;
@@ -886,17 +1098,19 @@ NOTE:
   sync callback clock should handle pause, resume, seek and seek finish events
  */
     Player& onSync(const std::function<double()>& cb, int minInterval = 10) {
-        {
-            const std::lock_guard<std::mutex> lock(sync_mtx_);
-            sync_cb_ = cb;
+        mdkSyncCallback callback{};
+        if (!cb) { // remove before releasing the callback
+            MDK_CALL(p, onSync, callback, minInterval);
+            sync_cb_.set(cb);
+            return *this;
         }
-        mdkSyncCallback callback;
+        sync_cb_.set(cb);
         callback.cb = [](void* opaque){
             auto p = (Player*)opaque;
-            const std::lock_guard<std::mutex> lock(p->sync_mtx_);
-            return p->sync_cb_();
+            const auto f = p->sync_cb_.get();
+            return f ? (*f)() : std::function<double()>()(); // the same as a null sync_cb_ before CallbackSlot
         };
-        callback.opaque = sync_cb_ ? this : nullptr;
+        callback.opaque = this;
         MDK_CALL(p, onSync, callback, minInterval);
         return *this;
     }
@@ -923,56 +1137,84 @@ NOTE:
     }
 #endif
 private:
+    template<bool HasCategoryId>
+    static bool onMediaEvent(const mdkMediaEvent* me, void* opaque) {
+        const auto f = static_cast<const CallbackSlot<bool(const MediaEvent&)>*>(opaque)->get();
+        if (!f)
+            return false;
+        MediaEvent e;
+        e.error = me->error;
+        e.category = me->category;
+        e.detail = me->detail;
+        e.decoder.stream = me->decoder.stream;
+        e.video.width = me->video.width;
+        e.video.height = me->video.height;
+        if (HasCategoryId)
+            e.category_id = me->category_id;
+        return (*f)(e);
+    }
+
+    // a removed keyed callback is released, but the slot is kept because the c api may be invoking it via opaque
+    template<typename F>
+    static void reset(std::map<CallbackToken, CallbackSlot<F>>& slots, std::map<CallbackToken, CallbackToken>& keys, const CallbackToken* token) {
+        if (token) {
+            const auto it = slots.find(*token);
+            if (it != slots.end())
+                it->second.set(nullptr);
+            keys.erase(*token);
+        } else {
+            for (auto& i : slots)
+                i.second.set(nullptr);
+            keys.clear();
+        }
+    }
+
     const mdkPlayerAPI* p = nullptr;
     bool owner_ = true;
     bool mute_ = false;
     float volume_ = 1.0f;
-    std::function<void()> current_cb_ = nullptr;
-    std::mutex current_mtx_;
-    std::function<bool(int64_t ms)> timeout_cb_ = nullptr;
-    std::mutex timeout_mtx_;
-    std::function<void(State)> state_cb_ = nullptr;
-    std::mutex state_mtx_;
-    std::function<void(void* vo_opaque)> render_cb_ = nullptr;
-    std::mutex render_mtx_;
-    std::function<void(bool)> switch_cb_ = nullptr;
-    std::mutex switch_mtx_;
-    std::function<int(VideoFrame&, int/*track*/)> video_cb_ = nullptr;
-    std::mutex video_mtx_;
-    std::function<double()> sync_cb_ = nullptr;
-    std::mutex sync_mtx_;
-    std::map<CallbackToken, std::function<bool(const MediaEvent&)>> event_cb_; // rb tree, elements never destroyed
+    CallbackHazards hazards_; // MUST be declared before all slots
+    CallbackSlot<void()> current_cb_{hazards_};
+    CallbackSlot<bool(int64_t ms)> timeout_cb_{hazards_};
+    CallbackSlot<void(State)> state_cb_{hazards_};
+    CallbackSlot<void(void* vo_opaque)> render_cb_{hazards_};
+    CallbackSlot<void(bool)> switch_cb_{hazards_};
+    CallbackSlot<int(VideoFrame&, int/*track*/)> video_cb_{hazards_};
+    CallbackSlot<double()> sync_cb_{hazards_};
+    CallbackSlot<void(MDK_BufferWatermark, const mdkBufferLevel&)> watermark_cb_{hazards_};
+    // keyed callbacks are invoked via the address of map element. the mutexes only serialize add/remove
+    std::map<CallbackToken, CallbackSlot<bool(const MediaEvent&)>> event_cb_; // rb tree, elements are never erased, see reset()
     std::map<CallbackToken,CallbackToken> event_cb_key_;
     std::mutex event_mtx_;
-    std::map<CallbackToken, std::function<void(int)>> loop_cb_; // rb tree, elements never destroyed
+    std::map<CallbackToken, CallbackSlot<void(int)>> loop_cb_;
     std::map<CallbackToken,CallbackToken> loop_cb_key_;
     std::mutex loop_mtx_;
-    std::map<CallbackToken, std::function<bool(MediaStatus, MediaStatus)>> status_cb_;
+    std::map<CallbackToken, CallbackSlot<bool(MediaStatus, MediaStatus)>> status_cb_;
     std::map<CallbackToken,CallbackToken> status_cb_key_;
     std::mutex status_mtx_;
 
     mutable MediaInfo info_;
+    mutable uint64_t info_gen_ = 0;
 };
 
 
 template<>
 inline Player& Player::onFrame(const std::function<int(VideoFrame&, int/*track*/)>& cb)
 {
-    {
-        const std::lock_guard<std::mutex> lock(video_mtx_);
-        video_cb_ = cb;
-    }
+    video_cb_.set(cb);
     mdkVideoCallback callback;
     callback.cb = [](mdkVideoFrameAPI** pFrame/*in/out*/, int track, void* opaque){
+        auto p = (Player*)opaque;
+        const auto f = p->video_cb_.get();
+        if (!f)
+            return 0;
         VideoFrame frame;
         frame.attach(*pFrame);
-        auto p = (Player*)opaque;
-        const std::lock_guard<std::mutex> lock(p->video_mtx_);
-        const auto pendings = p->video_cb_(frame, track);
+        const auto pendings = (*f)(frame, track);
         *pFrame = frame.detach();
         return pendings;
     };
-    callback.opaque = video_cb_ ? this : nullptr;
+    callback.opaque = cb ? this : nullptr;
     MDK_CALL(p, onVideo, callback);
     return *this;
 }
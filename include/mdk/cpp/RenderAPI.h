@@ -26,6 +26,7 @@ struct RenderAPI {
         Metal = 3,
         D3D11 = 4,
         D3D12 = 5,
+        Host = 64,
     };
 
     //Type type() const { return Type(type_ & 0xffff);}
@@ -259,4 +260,26 @@ struct VulkanRenderAPI final : RenderAPI {
     //const char*
     std::array<uint8_t, 32> reserved_opt; // color space etc.
 };
+
+/*!
+  \brief HostRenderAPI
+  Render into host memory without a gpu context. renderVideo() converts the next frame into a ring of host buffers, and the result is read from renderAPI().
+ */
+struct HostRenderAPI final : RenderAPI {
+    HostRenderAPI() {
+        type_ = versioned(RenderAPI::Host, sizeof(*this));
+    }
+/*** Render Target Options, set by user ***/
+    int format = -1; /* MDK_PixelFormat, i.e. int(PixelFormat) - 1. packed rgb: RGBA, RGBX, BGRA, BGRX or RGB24. -1 or others: RGBA */
+    int width = 0; /* output size. <= 0: frame size */
+    int height = 0;
+    int buffers = 3; /* number of host buffers in ring, also the max number of queued frames */
+/*** Render Result, set in renderVideo() ***/
+    const uint8_t* data = nullptr; /* the last rendered buffer, valid until `buffers` more frames are rendered or render api is changed */
+    int stride = 0;
+    int outWidth = 0;
+    int outHeight = 0;
+    double timestamp = -1; /* timestamp of rendered frame in seconds */
+    std::array<int8_t, 32> reserved;
+};
 MDK_NS_END
\ No newline at end of file
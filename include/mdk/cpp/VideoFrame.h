@@ -181,11 +181,23 @@ public:
   \param width output width. if invalid(<=0), same as width()
   \param height output height. if invalid(<=0), same as height()
   if all output parameters(invalid) are the same as input, return self
+  NOTE: the SIMD fast path and slicing of large frames(see mdkVideoFrameAPI.to) are off unless "videoframe.convert.matrix" global option is set
   \return Invalid frame if failed
  */
     VideoFrame to(PixelFormat format, int width = -1, int height = -1) {
         return VideoFrame(MDK_CALL(p, to, MDK_PixelFormat(int(format)-1), width, height));
     }
+/*!
+  \brief toBuffers
+  Convert and scale into caller provided planes, the same result as to(). Converted into data directly in fast path(see mdkVideoFrameAPI.toBuffers),
+  otherwise converted by to() to a temporary frame and copied.
+  \param data planes of output format. MUST be large enough for height rows of strides
+  \param strides in/out. strides of data. if null or strides[i] <= 0, rows are tightly packed, and the packed stride is written back to strides[i] if strides is not null
+  \return false if failed, or strides[i] > 0 but less than a packed row
+ */
+    bool toBuffers(PixelFormat format, int width, int height, uint8_t* const* data, int* strides = nullptr) const {
+        return MDK_CALL(p, toBuffers, MDK_PixelFormat(int(format)-1), width, height, data, strides);
+    }
 /*!
   \brief save
   Saves the frame to the file with the given fileName, using the given image file format and quality factor.
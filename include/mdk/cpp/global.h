@@ -329,6 +329,7 @@ public:
             int height;
         } video;
     } /* TODO: data */;
+    int category_id = MDK_EventCategory_Unknown; // interned id of category, see MDK_EventCategory. set if runtime supports Player.onEvent(cb, mask)
 };
 
 /*!
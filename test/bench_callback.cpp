@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+// invoke cost of a player callback slot while another thread re-registers the callback, and the max time of re-registration when callback is slow
+// usage: bench_callback [invoker threads] [seconds]
+#include "mdk/cpp/Player.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace MDK_NS;
+
+// callbacks before CallbackSlot
+class LockedSlot
+{
+public:
+    void set(const function<double()>& cb) {
+        const lock_guard<mutex> lock(mtx_);
+        f_ = cb;
+    }
+
+    double invoke() {
+        const lock_guard<mutex> lock(mtx_);
+        return f_();
+    }
+private:
+    mutex mtx_;
+    function<double()> f_;
+};
+
+class HazardSlot
+{
+public:
+    void set(const function<double()>& cb) { slot_.set(cb); }
+
+    double invoke() {
+        const auto f = slot_.get();
+        return (*f)();
+    }
+private:
+    CallbackHazards hazards_;
+    CallbackSlot<double()> slot_{hazards_};
+};
+
+template<class Slot>
+static void run(const char* name, int threads, double seconds, int setIntervalUs, int workUs = 0)
+{
+    Slot slot;
+    double v = 0;
+    const auto work = [&v, workUs]{
+        if (workUs > 0)
+            this_thread::sleep_for(chrono::microseconds(workUs));
+        return v;
+    };
+    slot.set(work);
+    atomic<bool> quit = false;
+    atomic<int64_t> calls = 0;
+    atomic<int64_t> sets = 0;
+    int64_t max_set_ns = 0;
+    thread setter;
+    if (setIntervalUs >= 0) {
+        setter = thread([&]{
+            while (!quit.load(memory_order_relaxed)) {
+                const auto t0 = chrono::steady_clock::now();
+                slot.set(work);
+                const auto dt = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count();
+                max_set_ns = max<int64_t>(max_set_ns, dt);
+                sets.fetch_add(1, memory_order_relaxed);
+                if (setIntervalUs > 0)
+                    this_thread::sleep_for(chrono::microseconds(setIntervalUs));
+            }
+        });
+    }
+    vector<thread> invokers;
+    for (int i = 0; i < threads; ++i) {
+        invokers.emplace_back([&]{
+            int64_t n = 0;
+            double sum = 0;
+            const int batch = workUs > 0 ? 1 : 1000;
+            while (!quit.load(memory_order_relaxed)) {
+                for (int k = 0; k < batch; ++k)
+                    sum += slot.invoke();
+                n += batch;
+            }
+            calls.fetch_add(n, memory_order_relaxed);
+            if (sum < 0)
+                printf("%f\n", sum);
+        });
+    }
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    quit = true;
+    for (auto& t : invokers)
+        t.join();
+    if (setter.joinable())
+        setter.join();
+    const double ns = seconds * 1e9 * threads / (double)calls.load();
+    printf("%-8s callback %5dus, set every %5dus: %10.2f ns/invoke, %8lld sets, max set %8.2f us\n"
+        , name, workUs, setIntervalUs, ns, (long long)sets.load(), max_set_ns / 1000.0);
+}
+
+int main(int argc, char* argv[])
+{
+    const int threads = argc > 1 ? atoi(argv[1]) : 2;
+    const double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+    printf("%d invoker threads, %.1fs each\n", threads, seconds);
+    for (int us : {-1, 1000, 10, 0}) { // -1: no re-registration
+        run<LockedSlot>("mutex", threads, seconds, us);
+        run<HazardSlot>("hazard", threads, seconds, us);
+    }
+    // slow user callback, e.g. a sync clock taking a lock
+    run<LockedSlot>("mutex", threads, seconds, 1000, 500);
+    run<HazardSlot>("hazard", threads, seconds, 1000, 500);
+    return 0;
+}
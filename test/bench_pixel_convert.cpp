@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+// throughput of VideoFrame.to() and toBuffers() per format pair, runtime conversion vs fast path("videoframe.convert.matrix" is set)
+// usage: bench_pixel_convert [frames(100)] [threads("videoframe.convert.threads", 0)]
+#include "mdk/cpp/VideoFrame.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+using namespace MDK_NS;
+
+template<typename F>
+static double ms_per_frame(int frames, F&& f)
+{
+    f(); // warm up, e.g. thread pool and scratch rows
+    const auto t0 = chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i)
+        f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() / frames;
+}
+
+int main(int argc, char* argv[])
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 100;
+    SetGlobalOption("videoframe.convert.threads", argc > 2 ? atoi(argv[2]) : 0);
+    const struct {
+        PixelFormat format;
+        const char* name;
+    } srcs[] = {
+        { PixelFormat::NV12, "nv12" },
+        { PixelFormat::YUV420P, "yuv420p" },
+        { PixelFormat::P010LE, "p010le" },
+    }, dsts[] = {
+        { PixelFormat::RGBA, "rgba" },
+        { PixelFormat::BGRA, "bgra" },
+        { PixelFormat::RGB24, "rgb24" },
+    };
+    const struct {
+        int w;
+        int h;
+    } sizes[] = { { 1920, 1080 }, { 3840, 2160 } };
+    printf("%-20s %-11s %12s %12s %12s %8s\n", "format", "output", "runtime ms", "to() ms", "toBuffers ms", "Mpix/s");
+    for (const auto& sz : sizes) {
+        for (const auto& s : srcs) {
+            VideoFrame frame(sz.w, sz.h, s.format);
+            frame.setBuffers(nullptr); // uninitialized planes, values do not change the speed
+            for (const auto& d : dsts) {
+                for (int half = 0; half < 2; ++half) {
+                    const int ow = half ? sz.w / 2 : sz.w;
+                    const int oh = half ? sz.h / 2 : sz.h;
+                    const int stride = ow * (d.format == PixelFormat::RGB24 ? 3 : 4);
+                    vector<uint8_t> out((size_t)stride * oh);
+                    uint8_t* planes[] = { out.data() };
+                    int strides[] = { stride };
+                    SetGlobalOption("videoframe.convert.matrix", "");
+                    const auto runtime = ms_per_frame(frames, [&]{ frame.to(d.format, ow, oh); });
+                    SetGlobalOption("videoframe.convert.matrix", "bt709");
+                    const auto to = ms_per_frame(frames, [&]{ frame.to(d.format, ow, oh); });
+                    const auto buffers = ms_per_frame(frames, [&]{ frame.toBuffers(d.format, ow, oh, planes, strides); });
+                    char name[32], output[32];
+                    snprintf(name, sizeof(name), "%s %dx%d", s.name, sz.w, sz.h);
+                    snprintf(output, sizeof(output), "%s %dx%d", d.name, ow, oh);
+                    printf("%-20s %-11s %12.3f %12.3f %12.3f %8.1f\n", name, output, runtime, to, buffers, (double)ow * oh / buffers / 1000.0);
+                }
+            }
+        }
+    }
+    SetGlobalOption("videoframe.convert.matrix", "");
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+// time of exact thumbnails at nearby timestamps, seek for each timestamp("thumbnail.forward_frames" is 0) vs decoding forward, and key frame thumbnails
+// usage: bench_thumbnail url [count(30)] [interval ms(200)] [start ms(0)]
+#include "mdk/c/Thumbnail.h"
+#include "mdk/c/global.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+struct Result {
+    int64_t max_diff = 0; // frameTime - timestamp, the same for seek and forward decoding if exact
+    int errors = 0;
+};
+
+static bool onThumbnail(int, int64_t timestamp, int64_t frameTime, int error, void* opaque)
+{
+    auto r = static_cast<Result*>(opaque);
+    if (error)
+        ++r->errors;
+    else if (frameTime - timestamp > r->max_diff)
+        r->max_diff = frameTime - timestamp;
+    return true;
+}
+
+static void run(mdkThumbnailer* t, mdkThumbnailRequest req, const char* name, int forwardFrames)
+{
+    MDK_setGlobalOptionInt32("thumbnail.forward_frames", forwardFrames);
+    Result r;
+    const auto t0 = chrono::steady_clock::now();
+    const int n = MDK_Thumbnailer_generate(t, &req, {&onThumbnail, &r});
+    const auto ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    printf("%-10s forward %4d: %4d written, %3d errors, max frame diff %5lld ms, %9.1f ms, %7.2f ms/thumbnail\n"
+        , name, forwardFrames, n, r.errors, (long long)r.max_diff, ms, n > 0 ? ms / n : 0.0);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        printf("usage: %s url [count(30)] [interval ms(200)] [start ms(0)]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const int count = argc > 2 ? atoi(argv[2]) : 30;
+    const int w = 320;
+    const int h = 180;
+    vector<uint8_t> buffers((size_t)count * w * h * 4);
+    vector<uint8_t*> data(count);
+    for (int i = 0; i < count; ++i)
+        data[i] = &buffers[(size_t)i * w * h * 4];
+    mdkThumbnailRequest req{};
+    req.url = argv[1];
+    req.count = count;
+    req.interval = argc > 3 ? atoi(argv[3]) : 200;
+    req.start = argc > 4 ? atoi(argv[4]) : 0;
+    req.width = w;
+    req.height = h;
+    req.data = data.data();
+    auto t = MDK_Thumbnailer_new();
+    req.exact = true;
+    run(t, req, "exact", 0);
+    run(t, req, "exact", 60);
+    run(t, req, "exact", 1000);
+    req.exact = false;
+    run(t, req, "key frame", 0);
+    MDK_setGlobalOptionInt32("thumbnail.forward_frames", 60);
+    MDK_Thumbnailer_delete(&t);
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+// VideoFrame.to() fast path("videoframe.convert.matrix" is set) against the runtime conversion
+// usage: test_pixel_convert [matrix(bt601)] [range(limited)]. matrix and range MUST be what the runtime uses for frames without color info
+#include "mdk/cpp/VideoFrame.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace MDK_NS;
+
+// smooth content, so that chroma upsampling and downscaling filters of the runtime give close results
+static VideoFrame make_frame(PixelFormat format, int w, int h)
+{
+    const bool p010 = format == PixelFormat::P010LE;
+    const int bps = p010 ? 2 : 1;
+    const int cw = (w + 1) / 2;
+    const int ch = (h + 1) / 2;
+    const bool planar = format == PixelFormat::YUV420P;
+    int strides[3] = { w * bps, (planar ? cw : cw * 2) * bps, planar ? cw : 0 };
+    vector<uint8_t> planes[3];
+    planes[0].resize((size_t)strides[0] * h);
+    planes[1].resize((size_t)strides[1] * ch);
+    planes[2].resize((size_t)strides[2] * ch);
+    const auto put = [&](int plane, int x, int y, double v) { // v in [0, 1]
+        if (p010) {
+            const uint16_t s = uint16_t(lround(64 + v * 876)) << 6;
+            memcpy(&planes[plane][(size_t)y * strides[plane] + x * 2], &s, 2);
+        } else {
+            planes[plane][(size_t)y * strides[plane] + x] = uint8_t(lround(16 + v * 219));
+        }
+    };
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x)
+            put(0, x, y, 0.5 + 0.5 * sin(x * 0.05) * cos(y * 0.03));
+    }
+    for (int y = 0; y < ch; ++y) {
+        for (int x = 0; x < cw; ++x) {
+            const double u = 0.5 + 0.4 * sin(x * 0.02 + y * 0.01);
+            const double v = 0.5 + 0.4 * cos(x * 0.015 - y * 0.02);
+            if (planar) {
+                put(1, x, y, u);
+                put(2, x, y, v);
+            } else {
+                put(1, 2 * x, y, u);
+                put(1, 2 * x + 1, y, v);
+            }
+        }
+    }
+    const uint8_t* data[3] = { planes[0].data(), planes[1].data(), planar ? planes[2].data() : nullptr };
+    return VideoFrame(w, h, format, strides, data); // copied
+}
+
+// max and mean absolute difference of rgb channels
+static bool compare(const VideoFrame& a, const VideoFrame& b, int bpp, int w, int h, int maxDiff, double maxMean, const char* name)
+{
+    if (!a || !b) {
+        printf("%s: invalid frame\n", name);
+        return false;
+    }
+    int diff = 0;
+    int64_t sum = 0;
+    for (int y = 0; y < h; ++y) {
+        const auto pa = a.bufferData(0) + (size_t)y * a.bytesPerLine(0);
+        const auto pb = b.bufferData(0) + (size_t)y * b.bytesPerLine(0);
+        for (int x = 0; x < w; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                const int d = abs(pa[x * bpp + c] - pb[x * bpp + c]);
+                diff = d > diff ? d : diff;
+                sum += d;
+            }
+        }
+    }
+    const double mean = double(sum) / (3.0 * w * h);
+    const bool ok = diff <= maxDiff && mean <= maxMean;
+    printf("%s: max diff %d, mean diff %.3f %s\n", name, diff, mean, ok ? "" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* matrix = argc > 1 ? argv[1] : "bt601";
+    const char* range = argc > 2 ? argv[2] : "limited";
+    const struct {
+        PixelFormat format;
+        const char* name;
+    } srcs[] = {
+        { PixelFormat::NV12, "nv12" },
+        { PixelFormat::YUV420P, "yuv420p" },
+        { PixelFormat::P010LE, "p010le" },
+    }, dsts[] = {
+        { PixelFormat::RGBA, "rgba" },
+        { PixelFormat::BGRA, "bgra" },
+        { PixelFormat::RGB24, "rgb24" },
+    };
+    const int w = 642;
+    const int h = 362;
+    int failed = 0;
+    for (const auto& s : srcs) {
+        auto frame = make_frame(s.format, w, h);
+        for (const auto& d : dsts) {
+            const int bpp = d.format == PixelFormat::RGB24 ? 3 : 4;
+            for (int half = 0; half < 2; ++half) {
+                const int ow = half ? w / 2 : w;
+                const int oh = half ? h / 2 : h;
+                SetGlobalOption("videoframe.convert.matrix", "");
+                const auto expected = frame.to(d.format, ow, oh);
+                SetGlobalOption("videoframe.convert.matrix", matrix);
+                SetGlobalOption("videoframe.convert.range", range);
+                const auto fast = frame.to(d.format, ow, oh);
+                char name[64];
+                snprintf(name, sizeof(name), "%s => %s %dx%d", s.name, d.name, ow, oh);
+                if (!compare(fast, expected, bpp, ow, oh, half ? 4 : 3, 1.0, name))
+                    ++failed;
+            }
+        }
+    }
+    SetGlobalOption("videoframe.convert.matrix", "");
+    printf("%d failed\n", failed);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024 WangBin <wbsecg1 at gmail.com>
+ */
+// function table of C api frames: every implemented entry is set, addBuffer takes the buffer ownership, and refs share the table
+#include "mdk/c/VideoFrame.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static int deleted = 0;
+
+static void deleteBuffer(void** pBuf)
+{
+    delete[] static_cast<uint8_t*>(*pBuf);
+    *pBuf = nullptr;
+    ++deleted;
+}
+
+#define CHECK(X) do { if (!(X)) { printf("%s:%d: %s FAILED\n", __FILE__, __LINE__, #X); ++failed; } } while (false)
+
+int main()
+{
+    int failed = 0;
+    const auto t = mdkVideoFrameAPI_table();
+    CHECK(t && !t->object);
+    CHECK(t->planeCount && t->width && t->height && t->format && t->setBuffers && t->bufferData && t->bytesPerLine);
+    CHECK(t->setTimestamp && t->timestamp && t->to && t->save && t->toBuffers && t->toRef);
+    CHECK(t->addBuffer); // not set before the shared table
+
+    const int w = 64;
+    const int h = 32;
+    auto f = mdkVideoFrameAPI_new(w, h, MDK_PixelFormat_RGBA);
+    CHECK(f && f->addBuffer == t->addBuffer);
+    auto buf = new uint8_t[w * 4 * h]();
+    CHECK(f->addBuffer(f->object, buf, w * 4, buf, deleteBuffer, 0));
+    CHECK(f->bufferData(f->object, 0) == buf);
+    CHECK(f->bytesPerLine(f->object, 0) == w * 4);
+    mdkVideoFrameAPI_delete(&f);
+    CHECK(!f && deleted == 1);
+
+    auto ref = mdkVideoFrameRef_new(w, h, MDK_PixelFormat_RGBA);
+    CHECK(ref.api == t && ref.object);
+    CHECK(ref.api->width(ref.object, -1) == w && ref.api->height(ref.object, -1) == h);
+    ref.api->setBuffers(ref.object, nullptr, nullptr); // allocate planes
+    auto rgb = ref.api->toRef(ref.object, MDK_PixelFormat_RGB24, w / 2, h / 2);
+    CHECK(rgb.api == t && rgb.object);
+    if (rgb.object)
+        CHECK(rgb.api->width(rgb.object, -1) == w / 2 && rgb.api->format(rgb.object) == MDK_PixelFormat_RGB24);
+    mdkVideoFrameRef_delete(&rgb);
+    mdkVideoFrameRef_delete(&ref);
+    CHECK(!ref.object);
+
+    printf("%d failed\n", failed);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}